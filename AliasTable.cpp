@@ -0,0 +1,119 @@
+//
+// AliasTable.cpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+
+#include "AliasTable.hpp"
+#include <stdexcept>
+#include <algorithm>
+
+
+using namespace std;
+
+
+AliasTable::AliasTable(const vector<double>& weights)
+:   entries_(weights.size())
+{
+    if (weights.empty()) return;
+
+    const size_t n = weights.size();
+    double total = 0;
+    for (vector<double>::const_iterator it=weights.begin(); it!=weights.end(); ++it)
+    {
+        if (*it < 0) throw runtime_error("[AliasTable] Negative weight.");
+        total += *it;
+    }
+
+    if (total <= 0) throw runtime_error("[AliasTable] Total weight is zero.");
+
+    // Vose: scale weights so the mean is 1, then pair each small column (< 1)
+    // with a large one, which donates the remainder of the small column
+
+    vector<double> scaled(n);
+    vector<size_t> small, large;
+    small.reserve(n);
+    large.reserve(n);
+
+    for (size_t i=0; i<n; ++i)
+    {
+        scaled[i] = weights[i] * n / total;
+        if (scaled[i] < 1)
+            small.push_back(i);
+        else
+            large.push_back(i);
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        size_t s = small.back(); small.pop_back();
+        size_t l = large.back();
+
+        entries_[s].threshold = scaled[s];
+        entries_[s].alias = l;
+
+        scaled[l] -= 1 - scaled[s];
+        if (scaled[l] < 1)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // leftovers are 1 up to rounding error
+
+    for (vector<size_t>::const_iterator it=large.begin(); it!=large.end(); ++it)
+        entries_[*it] = Entry();
+
+    for (vector<size_t>::const_iterator it=small.begin(); it!=small.end(); ++it)
+        entries_[*it] = Entry();
+
+    for (size_t i=0; i<n; ++i)
+        if (entries_[i].threshold >= 1) entries_[i].alias = i;
+}
+
+
+size_t AliasTable::random_index(const Random& random) const
+{
+    if (entries_.empty()) throw runtime_error("[AliasTable::random_index()] Empty table.");
+
+    // one roll: integer part picks the column, fractional part picks column or alias
+
+    double roll = random.random() * entries_.size();
+    size_t column = static_cast<size_t>(roll);
+    if (column >= entries_.size()) column = entries_.size() - 1; // rounding paranoia
+
+    const Entry& entry = entries_[column];
+    return (roll - column < entry.threshold) ? column : entry.alias;
+}
+
+
+double AliasTable::probability(size_t i) const
+{
+    const double n = double(entries_.size());
+    double result = 0;
+
+    for (size_t column=0; column<entries_.size(); ++column)
+    {
+        const Entry& entry = entries_[column];
+        if (column == i) result += min(entry.threshold, 1.0) / n;
+        if (entry.alias == i && entry.threshold < 1) result += (1 - entry.threshold) / n;
+    }
+
+    return result;
+}
+
+
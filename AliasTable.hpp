@@ -0,0 +1,62 @@
+//
+// AliasTable.hpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+
+#ifndef _ALIASTABLE_HPP_
+#define _ALIASTABLE_HPP_
+
+
+#include "Random.hpp"
+#include <vector>
+
+
+//
+// AliasTable: Walker/Vose alias method for sampling an index i with probability
+// proportional to weights[i]; O(n) construction, O(1) per draw (single Random draw)
+//
+class AliasTable
+{
+    public:
+
+    AliasTable() {}
+    AliasTable(const std::vector<double>& weights);
+
+    // return random index in [0, size())
+    size_t random_index(const Random& random) const;
+
+    size_t size() const {return entries_.size();}
+    bool empty() const {return entries_.empty();}
+
+    // probability of index i in the table's distribution (for testing)
+    double probability(size_t i) const;
+
+    private:
+
+    struct Entry
+    {
+        double threshold;   // keep column index if fractional part of roll < threshold
+        size_t alias;       // otherwise use this index
+        Entry() : threshold(1), alias(0) {}
+    };
+
+    std::vector<Entry> entries_;
+};
+
+
+#endif //  _ALIASTABLE_HPP_
+
@@ -0,0 +1,136 @@
+//
+// AliasTableTest.cpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+#include "AliasTable.hpp"
+#include "unit.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+
+
+using namespace std;
+
+
+ostream* os_ = 0;
+//ostream* os_ = &cout;
+
+
+void test_probabilities()
+{
+    if (os_) *os_ << "test_probabilities()\n";
+
+    vector<double> weights;
+    weights.push_back(.6);
+    weights.push_back(0);
+    weights.push_back(.2);
+    weights.push_back(.1);
+    weights.push_back(2.1);
+
+    AliasTable table(weights);
+    unit_assert(table.size() == weights.size());
+
+    const double epsilon = 1e-12;
+    for (size_t i=0; i<weights.size(); ++i)
+    {
+        if (os_) *os_ << i << " " << table.probability(i) << endl;
+        unit_assert_equal(table.probability(i), weights[i]/3, epsilon);
+    }
+
+    // uniform weights: every column keeps its own index
+
+    AliasTable uniform(vector<double>(7, 2.5));
+    for (size_t i=0; i<uniform.size(); ++i)
+        unit_assert_equal(uniform.probability(i), 1./7, epsilon);
+}
+
+
+void test_sampling()
+{
+    if (os_) *os_ << "test_sampling()\n";
+
+    vector<double> weights;
+    weights.push_back(1);
+    weights.push_back(0);
+    weights.push_back(2);
+    weights.push_back(5);
+
+    AliasTable table(weights);
+    Random random(123);
+
+    const size_t n = 80000;
+    vector<size_t> counts(weights.size());
+    for (size_t i=0; i<n; ++i)
+    {
+        size_t index = table.random_index(random);
+        unit_assert(index < weights.size());
+        counts[index]++;
+    }
+
+    for (size_t i=0; i<counts.size(); ++i)
+    {
+        if (os_) *os_ << "count " << i << ": " << counts[i] << endl;
+        unit_assert_equal(double(counts[i])/n, weights[i]/8, .01);
+    }
+
+    unit_assert(counts[1] == 0); // zero weight never chosen
+}
+
+
+void test_errors()
+{
+    if (os_) *os_ << "test_errors()\n";
+
+    AliasTable empty;
+    unit_assert(empty.empty());
+    unit_assert_throws(empty.random_index(Random()), runtime_error);
+
+    unit_assert_throws(AliasTable(vector<double>(3, 0)), runtime_error);
+    unit_assert_throws(AliasTable(vector<double>(3, -1)), runtime_error);
+}
+
+
+void test()
+{
+    test_probabilities();
+    test_sampling();
+    test_errors();
+}
+
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
+        test();
+        return 0;
+    }
+    catch(exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Caught unknown exception.\n";
+        return 1;
+    }
+}
+
+
@@ -0,0 +1,119 @@
+//
+// BlockArena.cpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+
+#include "BlockArena.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+
+using namespace std;
+
+
+namespace {
+
+thread_local BlockArena* current_arena_ = 0;
+
+} // namespace
+
+
+BlockArena::BlockArena(size_t chunk_size, bool recycle_chunks)
+:   chunk_size_(chunk_size), recycle_chunks_(recycle_chunks), used_(0), chunk_count_(0)
+{
+    if (chunk_size_ == 0) throw runtime_error("[BlockArena] Chunk size 0.");
+}
+
+
+shared_ptr<const DNABlock> BlockArena::store(const DNABlock* begin, const DNABlock* end)
+{
+    const size_t size = end - begin;
+
+    if (size == 0)
+        return shared_ptr<const DNABlock>();
+
+    if (size > chunk_size_)
+    {
+        // oversize array: chunk of its own, leaving the current chunk in place
+
+        shared_ptr<Chunk> chunk(new Chunk(begin, end));
+        ++chunk_count_;
+        return shared_ptr<const DNABlock>(chunk, &(*chunk)[0]);
+    }
+
+    if (!chunk_.get() || used_ + size > chunk_->size())
+    {
+        if (!free_chunks_.empty())
+        {
+            chunk_ = free_chunks_.back();
+            free_chunks_.pop_back();
+        }
+        else
+        {
+            chunk_.reset(new Chunk(chunk_size_));
+            ++chunk_count_;
+        }
+
+        used_ = 0;
+        if (recycle_chunks_) chunks_.push_back(chunk_);
+    }
+
+    DNABlock* result = &(*chunk_)[used_];
+    copy(begin, end, result);
+    used_ += size;
+
+    return shared_ptr<const DNABlock>(chunk_, result);
+}
+
+
+void BlockArena::recycle()
+{
+    chunk_.reset();
+    used_ = 0;
+
+    // a chunk held only by chunks_ has no Chromosomes left, and no other thread
+    // can get a new reference to it
+
+    for (vector< shared_ptr<Chunk> >::iterator it=chunks_.begin(); it!=chunks_.end(); ++it)
+        if (it->use_count() == 1)
+            free_chunks_.push_back(*it);
+
+    chunks_.clear();
+}
+
+
+BlockArena& BlockArena::current()
+{
+    if (current_arena_) return *current_arena_;
+
+    static thread_local BlockArena default_arena;
+    return default_arena;
+}
+
+
+BlockArena::Scope::Scope(BlockArena& arena)
+:   previous_(current_arena_)
+{
+    current_arena_ = &arena;
+}
+
+
+BlockArena::Scope::~Scope()
+{
+    current_arena_ = previous_;
+}
+
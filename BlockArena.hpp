@@ -0,0 +1,97 @@
+//
+// BlockArena.hpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+
+#ifndef _BLOCKARENA_HPP_
+#define _BLOCKARENA_HPP_
+
+
+#include "Chromosome.hpp"
+#include "shared_ptr.hpp"
+#include <vector>
+
+
+//
+// BlockArena: allocates DNABlock arrays from large chunks, so that the blocks of
+// a generation live in a few contiguous buffers instead of one heap allocation
+// per Chromosome.
+//
+// Each stored array holds a reference to its chunk (aliasing shared_ptr), so a
+// chunk is freed in one operation when the last Chromosome using it goes away,
+// and Chromosomes can be copied freely between populations.
+//
+// Chromosomes are created in the calling thread's current arena, set with
+// BlockArena::Scope (e.g. one arena per thread per generation), or else a
+// default thread-local arena.  An arena must be used by one thread at a time.
+//
+class BlockArena
+{
+    public:
+
+    // chunk_size: blocks per chunk (larger arrays get a chunk of their own)
+    // recycle_chunks: keep chunks for reuse by recycle() (see below)
+    BlockArena(size_t chunk_size = 1<<16, bool recycle_chunks = false);
+
+    // copy [begin, end) into the arena
+    shared_ptr<const DNABlock> store(const DNABlock* begin, const DNABlock* end);
+
+    // number of chunks allocated so far (reused chunks are not counted again)
+    size_t chunk_count() const {return chunk_count_;}
+
+    // with recycle_chunks: chunks that no Chromosome refers to anymore are reused
+    // for the next arrays stored; the arena lets go of the others, which are freed
+    // with their last Chromosome (e.g. call once per generation)
+    void recycle();
+
+    // the calling thread's current arena
+    static BlockArena& current();
+
+    // makes an arena the calling thread's current arena for the lifetime of the Scope
+    class Scope
+    {
+        public:
+        Scope(BlockArena& arena);
+        ~Scope();
+
+        private:
+        BlockArena* previous_;
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+    };
+
+    private:
+
+    typedef std::vector<DNABlock> Chunk;
+
+    size_t chunk_size_;
+    bool recycle_chunks_;
+    shared_ptr<Chunk> chunk_;
+    size_t used_;
+    size_t chunk_count_;
+
+    std::vector< shared_ptr<Chunk> > chunks_;     // handed out since the last recycle()
+    std::vector< shared_ptr<Chunk> > free_chunks_;
+
+    // disallow copying
+    BlockArena(const BlockArena&);
+    BlockArena& operator=(const BlockArena&);
+};
+
+
+#endif //  _BLOCKARENA_HPP_
+
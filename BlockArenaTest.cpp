@@ -0,0 +1,173 @@
+//
+// BlockArenaTest.cpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+#include "BlockArena.hpp"
+#include "unit.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+
+
+using namespace std;
+
+
+ostream* os_ = 0;
+//ostream* os_ = &cout;
+
+
+void test_store()
+{
+    if (os_) *os_ << "test_store()\n";
+
+    BlockArena arena(8);
+
+    DNABlocks blocks;
+    for (unsigned int i=0; i<5; ++i)
+        blocks.push_back(DNABlock(i*100, i));
+
+    // arrays are packed into a chunk until it is full
+
+    shared_ptr<const DNABlock> a = arena.store(&blocks[0], &blocks[0]+5);
+    shared_ptr<const DNABlock> b = arena.store(&blocks[0], &blocks[0]+3);
+    unit_assert(arena.chunk_count() == 1);
+    unit_assert(b.get() == a.get() + 5);
+
+    shared_ptr<const DNABlock> c = arena.store(&blocks[0], &blocks[0]+2);
+    unit_assert(arena.chunk_count() == 2);
+
+    for (size_t i=0; i<5; ++i) unit_assert(a.get()[i] == blocks[i]);
+    for (size_t i=0; i<3; ++i) unit_assert(b.get()[i] == blocks[i]);
+    for (size_t i=0; i<2; ++i) unit_assert(c.get()[i] == blocks[i]);
+
+    // oversize array: chunk of its own, current chunk still in use
+
+    DNABlocks big(20, DNABlock(7, 7));
+    shared_ptr<const DNABlock> d = arena.store(&big[0], &big[0]+big.size());
+    unit_assert(arena.chunk_count() == 3);
+    unit_assert(d.get()[19] == DNABlock(7, 7));
+
+    shared_ptr<const DNABlock> e = arena.store(&blocks[0], &blocks[0]+1);
+    unit_assert(arena.chunk_count() == 3);
+    unit_assert(e.get() == c.get() + 2);
+
+    unit_assert(!arena.store(&blocks[0], &blocks[0]).get());
+    unit_assert_throws(BlockArena(0), runtime_error);
+}
+
+
+void test_lifetime()
+{
+    if (os_) *os_ << "test_lifetime()\n";
+
+    // chromosomes keep their chunk alive after the arena is gone
+
+    Chromosome x, y;
+    {
+        BlockArena arena;
+        BlockArena::Scope scope(arena);
+        unit_assert(&BlockArena::current() == &arena);
+
+        x = Chromosome(1);
+        y = Chromosome(2);
+        unit_assert(y.blocks().begin() == x.blocks().begin() + 1);
+    }
+
+    unit_assert(&BlockArena::current() != 0);
+
+    vector<unsigned int> positions;
+    positions.push_back(1000);
+    Chromosome z(x, y, positions);
+
+    unit_assert(z.blocks().size() == 2);
+    unit_assert(z.blocks()[0] == DNABlock(0, 1));
+    unit_assert(z.blocks()[1] == DNABlock(1000, 2));
+
+    // copies share blocks
+
+    Chromosome z2 = z;
+    unit_assert(z2.blocks().begin() == z.blocks().begin());
+}
+
+
+void test_recycle()
+{
+    if (os_) *os_ << "test_recycle()\n";
+
+    BlockArena arena(4, true);
+
+    DNABlocks blocks(3, DNABlock(0, 1));
+
+    shared_ptr<const DNABlock> a = arena.store(&blocks[0], &blocks[0]+3);
+    shared_ptr<const DNABlock> b = arena.store(&blocks[0], &blocks[0]+3);
+    unit_assert(arena.chunk_count() == 2);
+
+    // chunk of a is released, chunk of b is still in use
+
+    const DNABlock* chunk_a = a.get();
+    a.reset();
+    arena.recycle();
+
+    shared_ptr<const DNABlock> c = arena.store(&blocks[0], &blocks[0]+2);
+    unit_assert(c.get() == chunk_a);
+    unit_assert(arena.chunk_count() == 2);
+
+    shared_ptr<const DNABlock> d = arena.store(&blocks[0], &blocks[0]+3);
+    unit_assert(arena.chunk_count() == 3);
+    unit_assert(b.get()[2] == blocks[2]);
+
+    // without recycle_chunks, chunks are never reused
+
+    BlockArena plain(4);
+    shared_ptr<const DNABlock> e = plain.store(&blocks[0], &blocks[0]+3);
+    e.reset();
+    plain.recycle();
+    e = plain.store(&blocks[0], &blocks[0]+3);
+    unit_assert(plain.chunk_count() == 2);
+}
+
+
+void test()
+{
+    test_store();
+    test_lifetime();
+    test_recycle();
+}
+
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
+        test();
+        return 0;
+    }
+    catch(exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Caught unknown exception.\n";
+        return 1;
+    }
+}
+
+
@@ -17,12 +17,14 @@
 //
 
 #include "Chromosome.hpp"
+#include "BlockArena.hpp"
 #include <iostream>
 #include <iterator>
 #include <stdexcept>
 #include <limits>
 #include <algorithm>
 #include <sstream>
+#include <atomic>
 
 
 using namespace std;
@@ -86,31 +88,46 @@ bool operator!=(const DNABlock& a, const DNABlock& b)
 //
 
 
-Chromosome::ID::ID(unsigned int encoded)
+namespace {
+
+typedef DNABlock::EncodedID Encoded;
+
+inline Encoded field_mask(unsigned int bits)
+{
+    return (Encoded(1) << bits) - 1;
+}
+
+inline unsigned int decode_field(Encoded encoded, unsigned int shift, unsigned int bits)
 {
-    population = (encoded & 0xf0000000) >> 28;
-    individual = (encoded & 0x0fffffc0) >> 6;
-    pair = (encoded & 0x3e) >> 1;
-    which = (encoded & 1);
+    return static_cast<unsigned int>((encoded >> shift) & field_mask(bits));
 }
 
+} // namespace
 
-Chromosome::ID::operator unsigned int() const
+
+Chromosome::ID::ID(DNABlock::EncodedID encoded)
 {
-    const unsigned int maxPopulation = 1<<4;
-    const unsigned int maxIndividual = 1<<22;
-    const unsigned int maxPair = 1<<5;
-    const unsigned int maxWhich = 1<<1;
-    
-    if (population >= maxPopulation) throw runtime_error("[Chromosome::ID] maxPopulation exceeded.");
-    if (individual >= maxIndividual) throw runtime_error("[Chromosome::ID] maxIndividual exceeded.");
-    if (pair >= maxPair) throw runtime_error("[Chromosome::ID] maxPair exceeded.");
-    if (which >= maxWhich) throw runtime_error("[Chromosome::ID] maxWhich exceeded.");
-
-    return (population << 28) |
-           (individual << 6) |
-           (pair << 1) | 
-           (which);
+    typedef ChromosomeIDLayout L;
+    population = decode_field(encoded, L::population_shift, L::population_bits);
+    individual = decode_field(encoded, L::individual_shift, L::individual_bits);
+    pair = decode_field(encoded, L::pair_shift, L::pair_bits);
+    which = decode_field(encoded, L::which_shift, L::which_bits);
+}
+
+
+Chromosome::ID::operator DNABlock::EncodedID() const
+{
+    typedef ChromosomeIDLayout L;
+
+    if (population > field_mask(L::population_bits)) throw runtime_error("[Chromosome::ID] maxPopulation exceeded.");
+    if (individual > field_mask(L::individual_bits)) throw runtime_error("[Chromosome::ID] maxIndividual exceeded.");
+    if (pair > field_mask(L::pair_bits)) throw runtime_error("[Chromosome::ID] maxPair exceeded.");
+    if (which > field_mask(L::which_bits)) throw runtime_error("[Chromosome::ID] maxWhich exceeded.");
+
+    return (Encoded(population) << L::population_shift) |
+           (Encoded(individual) << L::individual_shift) |
+           (Encoded(pair) << L::pair_shift) | 
+           (Encoded(which) << L::which_shift);
 }
 
 
@@ -143,33 +160,150 @@ istream& operator>>(istream& is, Chromosome::ID& x)
 //
 
 
-Chromosome::Chromosome(unsigned int id)
+namespace
+{
+
+struct ComparePosition
+{
+    bool operator()(const DNABlock& a, const DNABlock& b) const {return a.position < b.position;}
+};
+
+
+struct HasSameID
 {
-    blocks_.push_back(DNABlock(0, id));
+    bool operator()(const DNABlock& a, const DNABlock& b) const {return a.id == b.id;}
+};
+
+
+std::atomic<size_t> coalesced_block_count_(0);
+
+
+// append block, coalescing it with the previous block if they have the same id
+inline void append_block(const DNABlock& block, DNABlocks& result, size_t& coalesced)
+{
+    if (result.empty() || result.back().id != block.id)
+        result.push_back(block);
+    else
+        ++coalesced;
+}
+
+
+// coalesce adjacent blocks with the same id, in place; returns # eliminated
+size_t coalesce(DNABlocks& blocks)
+{
+    DNABlocks::iterator end = unique(blocks.begin(), blocks.end(), HasSameID());
+    size_t coalesced = blocks.end() - end;
+    blocks.erase(end, blocks.end());
+    return coalesced;
+}
+
+
+//
+// append the blocks of parent covering [position_begin, position_end)
+//
+// cursor: index of a block at or before the one containing position_begin; on
+// return, index of the block containing the last appended position, so that the
+// next (later) segment from the same parent is searched for from there
+//
+void merge_segment(const DNABlockSpan& parent, size_t& cursor,
+                   unsigned int position_begin, unsigned int position_end,
+                   DNABlocks& result, size_t& coalesced)
+{
+    DNABlockSpan::const_iterator it = upper_bound(parent.begin() + cursor, parent.end(),
+                                                  DNABlock(position_begin, 0), ComparePosition());
+    if (it == parent.begin())
+        throw runtime_error("[Chromosome::Chromosome()] No block at position.");
+
+    --it; // block containing position_begin
+    append_block(DNABlock(position_begin, it->id), result, coalesced);
+
+    for (++it; it!=parent.end() && it->position<position_end; ++it)
+        append_block(*it, result, coalesced);
+
+    cursor = it - parent.begin() - 1;
+}
+
+} // namespace
+
+
+Chromosome::Chromosome(DNABlock::EncodedID id)
+:   size_(0)
+{
+    DNABlock block(0, id);
+    blocks_ = BlockArena::current().store(&block, &block+1);
+    size_ = 1;
 }
 
 
 Chromosome::Chromosome(const DNABlocks& blocks)
-:   blocks_(blocks)
-{}
+:   size_(0)
+{
+    DNABlocks canonical(blocks);
+    coalesced_block_count_ += coalesce(canonical);
+    assign(canonical);
+}
 
 
 Chromosome::Chromosome(const Chromosome& x, const Chromosome& y, const vector<unsigned int>& positions)
+:   size_(0)
 {
+    // no crossover (positions empty or all 0): straight copy of the parent's
+    // blocks, which are already canonical, into the current arena; sharing the
+    // parent's array would keep its whole chunk alive for as long as the child
+
+    if (positions.empty() || positions.back() == 0)
+    {
+        const Chromosome& parent = (positions.size() % 2 == 0) ? x : y;
+        blocks_ = BlockArena::current().store(parent.blocks_.get(), parent.blocks_.get() + parent.size_);
+        size_ = parent.size_;
+        return;
+    }
+
+    // single pass: segments are visited in increasing position order, so each
+    // parent is walked once with a cursor; output is built in a per-thread
+    // scratch buffer, then copied into the arena
+
+    const DNABlockSpan x_blocks = x.blocks();
+    const DNABlockSpan y_blocks = y.blocks();
+
+    static thread_local DNABlocks blocks;
+    blocks.clear();
+    blocks.reserve(x_blocks.size() + y_blocks.size() + positions.size() + 1);
+
+    size_t x_cursor = 0, y_cursor = 0;
+    size_t coalesced = 0;
     bool copy_from_x = true; // false == copy from y
-    size_t position_previous = 0;
+    unsigned int position_previous = 0;
 
     for (vector<unsigned int>::const_iterator position=positions.begin(); position!=positions.end(); ++position)
     {
-        const Chromosome* p = copy_from_x ? &x : &y;
-        p->extract_blocks(position_previous, *position, blocks_);
+        if (position_previous < *position)
+        {
+            if (copy_from_x)
+                merge_segment(x_blocks, x_cursor, position_previous, *position, blocks, coalesced);
+            else
+                merge_segment(y_blocks, y_cursor, position_previous, *position, blocks, coalesced);
+        }
 
         copy_from_x = !copy_from_x; 
         position_previous = *position;
     }
 
-    const Chromosome* p = copy_from_x ? &x : &y;
-    p->extract_blocks(position_previous, numeric_limits<unsigned int>::max(), blocks_);
+    if (copy_from_x)
+        merge_segment(x_blocks, x_cursor, position_previous, numeric_limits<unsigned int>::max(), blocks, coalesced);
+    else
+        merge_segment(y_blocks, y_cursor, position_previous, numeric_limits<unsigned int>::max(), blocks, coalesced);
+
+    if (coalesced) coalesced_block_count_ += coalesced;
+    assign(blocks);
+}
+
+
+void Chromosome::assign(const DNABlocks& blocks)
+{
+    blocks_ = blocks.empty() ? shared_ptr<const DNABlock>() :
+        BlockArena::current().store(&blocks[0], &blocks[0] + blocks.size());
+    size_ = blocks.size();
 }
 
 
@@ -177,36 +311,27 @@ void Chromosome::extract_blocks(unsigned int position_begin,
                                 unsigned int position_end,
                                 DNABlocks& result) const
 {
-    DNABlocks::const_iterator begin = lower_bound(blocks_.begin(), blocks_.end(), DNABlock(position_begin,0));
-    DNABlocks::const_iterator end = lower_bound(blocks_.begin(), blocks_.end(), DNABlock(position_end,0));
+    const DNABlockSpan blocks = this->blocks();
+    DNABlockSpan::const_iterator begin = lower_bound(blocks.begin(), blocks.end(), DNABlock(position_begin,0));
+    DNABlockSpan::const_iterator end = lower_bound(blocks.begin(), blocks.end(), DNABlock(position_end,0));
 
-    if (begin == blocks_.end() || position_begin < begin->position)
+    if (begin == blocks.end() || position_begin < begin->position)
     {
-        if (begin-1 < blocks_.begin()) throw runtime_error("[Chromosome::extract_blocks()] Blech.");
+        if (begin == blocks.begin()) throw runtime_error("[Chromosome::extract_blocks()] Blech.");
         result.push_back(DNABlock(position_begin, (begin-1)->id));
     }
 
-    copy(begin, end, back_inserter(result));
+    result.insert(result.end(), begin, end);
 }
 
 
-namespace
-{
-
-struct ComparePosition
-{
-    bool operator()(const DNABlock& a, const DNABlock& b) const {return a.position < b.position;}
-};
-
-} // namespace
-
-
 const DNABlock& Chromosome::find_block(unsigned int position, size_t index_begin) const
 {
-    if (index_begin >= blocks_.size()) throw runtime_error("[Chromosome::find_block()] Bad index_begin.");
+    if (index_begin >= size_) throw runtime_error("[Chromosome::find_block()] Bad index_begin.");
 
-    DNABlocks::const_iterator it = upper_bound(blocks_.begin() + index_begin, blocks_.end(), 
-                                               DNABlock(position, 0), ComparePosition()); // returns first block with higher position
+    const DNABlockSpan blocks = this->blocks();
+    DNABlockSpan::const_iterator it = upper_bound(blocks.begin() + index_begin, blocks.end(), 
+                                                  DNABlock(position, 0), ComparePosition()); // returns first block with higher position
     return *(it-1);
 }
 
@@ -216,16 +341,30 @@ void Chromosome::read(istream& is)
     size_t block_count = 0;
     is.read((char*)&block_count, sizeof(size_t));
     if (block_count > 10000) throw runtime_error("[Chromosome::read()] Bad block_count.");
-    blocks_.resize(block_count);
-    is.read((char*)&blocks_[0], sizeof(DNABlock)*block_count);
+    DNABlocks blocks(block_count);
+    if (block_count) is.read((char*)&blocks[0], sizeof(DNABlock)*block_count);
+    coalesced_block_count_ += coalesce(blocks);
+    assign(blocks);
 }
 
 
 void Chromosome::write(ostream& os) const
 {
-    size_t block_count = blocks_.size();
+    size_t block_count = size_;
     os.write((const char*)&block_count, sizeof(size_t));
-    os.write((const char*)&blocks_[0], sizeof(DNABlock)*block_count);
+    os.write((const char*)blocks_.get(), sizeof(DNABlock)*block_count);
+}
+
+
+size_t Chromosome::coalesced_block_count()
+{
+    return coalesced_block_count_;
+}
+
+
+void Chromosome::reset_coalesced_block_count()
+{
+    coalesced_block_count_ = 0;
 }
 
 
@@ -233,10 +372,7 @@ bool operator==(const Chromosome& a, const Chromosome& b)
 {
     if (a.blocks().size() != b.blocks().size()) return false;
 
-    for (DNABlocks::const_iterator it=a.blocks().begin(), jt=b.blocks().begin(); it!=a.blocks().end(); ++it,++jt)
-        if (*it != *jt) return false;
-
-    return true;
+    return equal(a.blocks().begin(), a.blocks().end(), b.blocks().begin());
 }
 
 
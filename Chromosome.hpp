@@ -20,20 +20,79 @@
 #define _CHROMOSOME_HPP_
 
 
+#include "Span.hpp"
+#include "shared_ptr.hpp"
+#include "boost/static_assert.hpp"
 #include <iosfwd>
 #include <vector>
+#include <stdint.h>
+
+
+//
+// IDLayout: bit layout of an encoded Chromosome::ID, from high to low bits:
+//     population | individual | pair | which (1 bit)
+//
+template <typename EncodedType, unsigned int PopulationBits, unsigned int IndividualBits, unsigned int PairBits>
+struct IDLayout
+{
+    typedef EncodedType Encoded;
+
+    enum
+    {
+        population_bits = PopulationBits,
+        individual_bits = IndividualBits,
+        pair_bits = PairBits,
+        which_bits = 1,
+
+        which_shift = 0,
+        pair_shift = which_bits,
+        individual_shift = pair_shift + pair_bits,
+        population_shift = individual_shift + individual_bits
+    };
+
+    BOOST_STATIC_ASSERT(population_shift + population_bits <= 8*sizeof(Encoded));
+    BOOST_STATIC_ASSERT(population_bits <= 32 && individual_bits <= 32 && pair_bits <= 32);
+};
+
+
+//
+// ID encoding, chosen at compile time:
+//   default:            32-bit, 4 bits population, 22 bits individual, 5 bits pair
+//   SIMRECOMB_ID_64:    64-bit, 16 bits population, 32 bits individual, 8 bits pair
+//                       (DNABlock grows from 8 to 16 bytes; binary population files
+//                       are not interchangeable between the two)
+// Field widths can be overridden with SIMRECOMB_ID_POPULATION_BITS,
+// SIMRECOMB_ID_INDIVIDUAL_BITS and SIMRECOMB_ID_PAIR_BITS.
+//
+#ifdef SIMRECOMB_ID_64
+#define SIMRECOMB_ID_ENCODED uint64_t
+#define SIMRECOMB_ID_DEFAULT_BITS 16, 32, 8
+#else
+#define SIMRECOMB_ID_ENCODED unsigned int
+#define SIMRECOMB_ID_DEFAULT_BITS 4, 22, 5
+#endif
+
+#if defined(SIMRECOMB_ID_POPULATION_BITS) && defined(SIMRECOMB_ID_INDIVIDUAL_BITS) && defined(SIMRECOMB_ID_PAIR_BITS)
+typedef IDLayout<SIMRECOMB_ID_ENCODED, SIMRECOMB_ID_POPULATION_BITS,
+                 SIMRECOMB_ID_INDIVIDUAL_BITS, SIMRECOMB_ID_PAIR_BITS> ChromosomeIDLayout;
+#else
+typedef IDLayout<SIMRECOMB_ID_ENCODED, SIMRECOMB_ID_DEFAULT_BITS> ChromosomeIDLayout;
+#endif
 
 
 struct DNABlock
 {
+    typedef ChromosomeIDLayout::Encoded EncodedID;
+
     unsigned int position;       // position in chromosome
-    unsigned int id;             // id of original DNA source
+    EncodedID id;                // id of original DNA source (encoded Chromosome::ID)
 
-    DNABlock(unsigned int _position = 0, unsigned int _id = 0) : position(_position), id(_id) {}
+    DNABlock(unsigned int _position = 0, EncodedID _id = 0) : position(_position), id(_id) {}
 };
 
 
-typedef std::vector<DNABlock> DNABlocks;
+typedef std::vector<DNABlock> DNABlocks;   // for building block lists
+typedef Span<DNABlock> DNABlockSpan;       // view of a Chromosome's blocks
 
 
 std::ostream& operator<<(std::ostream& os, const DNABlock& x);
@@ -48,12 +107,12 @@ class Chromosome
 {
     public:
 
-    // ID structure, encoded as a single int
+    // ID structure, encoded as a single DNABlock::EncodedID (see ChromosomeIDLayout)
     struct ID
     {
-        unsigned int population; // (4 bits)
-        unsigned int individual; // (22 bits)
-        unsigned int pair;       // (5 bits) e.g. 0-22 for humans
+        unsigned int population; // (default 4 bits)
+        unsigned int individual; // (default 22 bits)
+        unsigned int pair;       // (default 5 bits) e.g. 0-22 for humans
         unsigned int which;      // (1 bit) 
         
         ID(unsigned int _population,
@@ -66,18 +125,29 @@ class Chromosome
             which(_which)
         {}
 
-        // decoding from unsigned int
-        ID(unsigned int encoded);
+        // decoding
+        ID(DNABlock::EncodedID encoded);
 
-        // conversion to unsigned int
-        operator unsigned int() const;
+        // encoding
+        operator DNABlock::EncodedID() const;
     };
 
+    //
+    // A Chromosome's blocks are immutable, stored in the current thread's BlockArena
+    // (see BlockArena.hpp), and shared by copies of the Chromosome.
+    //
+    // Blocks are kept in canonical form: adjacent blocks with the same id are
+    // coalesced on construction (including recombination and read()).
+    //
+    // A non-recombinant child copies its parent's blocks into its own arena (no
+    // merge), so that it doesn't keep the parent generation's chunks alive.
+    //
+
     // default constructor
-    Chromosome() {}
+    Chromosome() : size_(0) {}
 
     // new chromosome, with single DNABlock
-    Chromosome(unsigned int id); 
+    Chromosome(DNABlock::EncodedID id); 
 
     // new chromosome with specified DNABlocks, for testing
     Chromosome(const DNABlocks& blocks);
@@ -89,7 +159,7 @@ class Chromosome
     Chromosome(const Chromosome& x, const Chromosome& y, const std::vector<unsigned int>& positions); 
 
     // const access to DNABlocks
-    const DNABlocks& blocks() const {return blocks_;}
+    DNABlockSpan blocks() const {return DNABlockSpan(blocks_.get(), size_);}
 
     // append blocks (from position_begin to position_end) to result
     void extract_blocks(unsigned int position_begin, unsigned int position_end, DNABlocks& result) const;
@@ -101,8 +171,15 @@ class Chromosome
     void read(std::istream& is);
     void write(std::ostream& os) const;
 
+    // number of redundant blocks eliminated by coalescing, over all threads
+    static size_t coalesced_block_count();
+    static void reset_coalesced_block_count();
+
     private:
-    DNABlocks blocks_;
+    shared_ptr<const DNABlock> blocks_; // points into a BlockArena chunk
+    size_t size_;
+
+    void assign(const DNABlocks& blocks); // blocks must be canonical
 };
 
 
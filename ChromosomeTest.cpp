@@ -17,15 +17,22 @@
 //
 
 #include "Chromosome.hpp"
+#include "BlockArena.hpp"
 #include "unit.hpp"
 #include <boost/static_assert.hpp>
 #include <iostream>
 #include <map>
 #include <cstring>
 #include <algorithm>
+#include <limits>
+#include <cstdlib>
 
 
+#ifdef SIMRECOMB_ID_64
+BOOST_STATIC_ASSERT(sizeof(DNABlock) == 16);
+#else
 BOOST_STATIC_ASSERT(sizeof(DNABlock) == 8); // make sure int is 32-bit
+#endif
 
 
 using namespace std;
@@ -93,7 +100,7 @@ void test_id()
     Chromosome::ID id(population, individual, pair, which);
     if (os_) *os_ << "id: " << id << endl;
 
-    unsigned int encoded = (unsigned int)(id);
+    DNABlock::EncodedID encoded = (DNABlock::EncodedID)(id);
     if (os_) *os_ << "encoded: " << hex << encoded << dec << endl;
 
     Chromosome::ID id2(encoded);
@@ -104,6 +111,26 @@ void test_id()
 
     unit_assert(id == id2); // from automatic conversion
 
+    // field limits from the layout
+
+    typedef ChromosomeIDLayout L;
+    const unsigned int max_population = (1ull << L::population_bits) - 1;
+    const unsigned int max_individual = (1ull << L::individual_bits) - 1;
+    const unsigned int max_pair = (1ull << L::pair_bits) - 1;
+
+    Chromosome::ID id_max(max_population, max_individual, max_pair, 1);
+    Chromosome::ID id_max2((DNABlock::EncodedID)id_max);
+    unit_assert(id_max2.population == max_population);
+    unit_assert(id_max2.individual == max_individual);
+    unit_assert(id_max2.pair == max_pair);
+    unit_assert(id_max2.which == 1);
+
+    if (L::population_bits < 32)
+        unit_assert_throws((DNABlock::EncodedID)Chromosome::ID(max_population+1, 0, 0, 0), runtime_error);
+    if (L::individual_bits < 32)
+        unit_assert_throws((DNABlock::EncodedID)Chromosome::ID(0, max_individual+1, 0, 0), runtime_error);
+    unit_assert_throws((DNABlock::EncodedID)Chromosome::ID(0, 0, 0, 2), runtime_error);
+
     if (os_) *os_ << endl;
 }
 
@@ -272,7 +299,7 @@ void test_recombine()
     Chromosome e(x, y, e_positions);
     if (os_) *os_ << "e: " << e << endl;
     unit_assert(e.blocks().size() == 3);
-    DNABlocks::const_iterator it = e.blocks().begin();
+    DNABlockSpan::const_iterator it = e.blocks().begin();
     unit_assert(it->id == 1);
     unit_assert(it->position == 0);
     ++it;
@@ -382,7 +409,7 @@ void test_recombine_2()
     if (os_) *os_ << "c: " << c << endl;
 
     unit_assert(c.blocks().size() == 5);
-    DNABlocks::const_iterator it = c.blocks().begin();
+    DNABlockSpan::const_iterator it = c.blocks().begin();
     unit_assert(it->position == 0);
     unit_assert(it->id == 1);
     ++it;
@@ -457,7 +484,7 @@ void test_recombine_3()
     if (os_) *os_ << "ch_c: " << ch_c << endl;
             
     unit_assert(ch_c.blocks().size() == 6);
-    DNABlocks::const_iterator it = ch_c.blocks().begin();
+    DNABlockSpan::const_iterator it = ch_c.blocks().begin();
     unit_assert(it->position == 0);
     unit_assert(it->id == 1);
     ++it;
@@ -556,7 +583,7 @@ void test_recombine_4()
     if (os_) *os_ << "ch_c: " << ch_c << endl;
 
     unit_assert(ch_c.blocks().size() == 4);
-    DNABlocks::const_iterator it = ch_c.blocks().begin();
+    DNABlockSpan::const_iterator it = ch_c.blocks().begin();
     unit_assert(it->position == 0);
     unit_assert(it->id == 101);
     ++it;
@@ -640,6 +667,183 @@ void test_find_block()
 }
 
 
+// reference recombination: extract_blocks() per segment, then coalesce
+DNABlocks recombine_reference(const Chromosome& x, const Chromosome& y, const vector<unsigned int>& positions)
+{
+    DNABlocks extracted;
+    bool copy_from_x = true;
+    unsigned int position_previous = 0;
+
+    for (size_t i=0; i<=positions.size(); ++i)
+    {
+        unsigned int position = i<positions.size() ? positions[i] : numeric_limits<unsigned int>::max();
+        if (position_previous < position)
+            (copy_from_x ? x : y).extract_blocks(position_previous, position, extracted);
+        copy_from_x = !copy_from_x;
+        position_previous = position;
+    }
+
+    DNABlocks result;
+    for (DNABlocks::const_iterator it=extracted.begin(); it!=extracted.end(); ++it)
+        if (result.empty() || result.back().id != it->id)
+            result.push_back(*it);
+    return result;
+}
+
+
+void test_recombine_merge()
+{
+    if (os_) *os_ << "test_recombine_merge()\n";
+
+    // adjacent segments from the same ancestor are coalesced
+
+    DNABlocks blocks_x;
+    blocks_x.push_back(DNABlock(0, 1));
+    blocks_x.push_back(DNABlock(100, 2));
+    DNABlocks blocks_y;
+    blocks_y.push_back(DNABlock(0, 3));
+    blocks_y.push_back(DNABlock(50, 2));
+
+    vector<unsigned int> positions;
+    positions.push_back(75);
+    positions.push_back(150);
+
+    Chromosome c(Chromosome(blocks_x), Chromosome(blocks_y), positions);
+    unit_assert(c.blocks().size() == 2);
+    unit_assert(c.blocks()[0] == DNABlock(0, 1));
+    unit_assert(c.blocks()[1] == DNABlock(75, 2));
+
+    // random parents and crossovers: same blocks as the per-segment reference
+
+    srand(1);
+    for (int iteration=0; iteration<1000; ++iteration)
+    {
+        DNABlocks parent_blocks[2];
+        for (int p=0; p<2; ++p)
+        {
+            unsigned int position = 0;
+            size_t count = 1 + rand()%20;
+            for (size_t i=0; i<count; ++i, position += 1 + rand()%100)
+                parent_blocks[p].push_back(DNABlock(position, rand()%4));
+        }
+
+        Chromosome x(parent_blocks[0]), y(parent_blocks[1]);
+
+        vector<unsigned int> positions;
+        size_t count = rand()%6;
+        for (size_t i=0; i<count; ++i) positions.push_back(rand()%2000);
+        sort(positions.begin(), positions.end());
+
+        Chromosome child(x, y, positions);
+        DNABlocks expected = recombine_reference(x, y, positions);
+
+        unit_assert(child.blocks().size() == expected.size());
+        unit_assert(equal(expected.begin(), expected.end(), child.blocks().begin()));
+    }
+}
+
+
+void test_canonical()
+{
+    if (os_) *os_ << "test_canonical()\n";
+
+    Chromosome::reset_coalesced_block_count();
+
+    DNABlocks blocks;
+    blocks.push_back(DNABlock(0, 1));
+    blocks.push_back(DNABlock(10, 1));
+    blocks.push_back(DNABlock(20, 2));
+    blocks.push_back(DNABlock(30, 2));
+    blocks.push_back(DNABlock(40, 2));
+    blocks.push_back(DNABlock(50, 1));
+
+    Chromosome c(blocks);
+    unit_assert(c.blocks().size() == 3);
+    unit_assert(c.blocks()[0] == DNABlock(0, 1));
+    unit_assert(c.blocks()[1] == DNABlock(20, 2));
+    unit_assert(c.blocks()[2] == DNABlock(50, 1));
+    unit_assert(Chromosome::coalesced_block_count() == 3);
+
+    // crossover between two segments of the same ancestor
+
+    DNABlocks blocks_y;
+    blocks_y.push_back(DNABlock(0, 2));
+    Chromosome y(blocks_y);
+
+    vector<unsigned int> positions;
+    positions.push_back(25);
+    Chromosome d(c, y, positions);
+    unit_assert(d.blocks().size() == 2);
+    unit_assert(d.blocks()[1] == DNABlock(20, 2));
+    unit_assert(Chromosome::coalesced_block_count() == 4);
+
+    Chromosome::reset_coalesced_block_count();
+    unit_assert(Chromosome::coalesced_block_count() == 0);
+}
+
+
+void test_recombine_no_crossover()
+{
+    if (os_) *os_ << "test_recombine_no_crossover()\n";
+
+    DNABlocks blocks_x;
+    blocks_x.push_back(DNABlock(0, 1));
+    blocks_x.push_back(DNABlock(100, 2));
+
+    BlockArena parents(16, true);
+    BlockArena children(16, true);
+
+    Chromosome x, y;
+    {
+        BlockArena::Scope scope(parents);
+        x = Chromosome(blocks_x);
+        y = Chromosome(3);
+    }
+
+    // no crossover: child gets a merge-free copy of the parent's blocks in its
+    // own arena (not a shared pointer into the parent's chunk)
+
+    Chromosome a, b, c, d;
+    {
+        BlockArena::Scope scope(children);
+
+        vector<unsigned int> positions;
+        a = Chromosome(x, y, positions);
+
+        positions.push_back(0);
+        b = Chromosome(x, y, positions);
+
+        positions.push_back(0);
+        c = Chromosome(x, y, positions);
+
+        // crossover
+
+        positions.push_back(50);
+        d = Chromosome(x, y, positions);
+    }
+
+    unit_assert(a == x);
+    unit_assert(a.blocks().begin() != x.blocks().begin());
+    unit_assert(b == y);
+    unit_assert(b.blocks().begin() != y.blocks().begin());
+    unit_assert(c == x);
+    unit_assert(d.blocks().size() == 2);
+    unit_assert(children.chunk_count() == 1);
+
+    // the children don't keep the parents' chunk alive: it is reused once the
+    // parents are gone
+
+    x = y = Chromosome();
+    parents.recycle();
+    {
+        BlockArena::Scope scope(parents);
+        Chromosome e(4);
+    }
+    unit_assert(parents.chunk_count() == 1);
+    unit_assert(a.blocks().size() == 2 && a.blocks()[1] == DNABlock(100, 2));
+}
+
+
 void test()
 {
     test_DNABlock();
@@ -654,6 +858,9 @@ void test()
     test_recombine_2();
     test_recombine_3();
     test_recombine_4();
+    test_recombine_merge();
+    test_canonical();
+    test_recombine_no_crossover();
     test_write_read_binary();
     test_find_block();
 }
@@ -19,6 +19,7 @@
 
 #include "DataVector.hpp"
 #include <iterator>
+#include <iostream>
 #include <numeric>
 
 
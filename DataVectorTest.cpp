@@ -21,6 +21,7 @@
 #include "unit.hpp"
 #include <iostream>
 #include <iterator>
+#include <cstring>
 
 
 using namespace std;
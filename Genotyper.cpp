@@ -18,8 +18,13 @@
 
 
 #include "Genotyper.hpp"
+#include "Parallel.hpp"
 #include <iostream>
-#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
 
 
 //
@@ -58,10 +63,161 @@ std::ostream& operator<<(std::ostream& os, const Locus& locus)
 //
 
 
+namespace {
+
+
+// popcounts of the two interleaved bit planes: plane0 += bits set in words[0,2,4..],
+// plane1 += bits set in words[1,3,5..]; word_count is even
+
+typedef void (*PlanePopcounts)(const uint64_t* words, size_t word_count, size_t& plane0, size_t& plane1);
+
+
+void plane_popcounts_scalar(const uint64_t* words, size_t word_count, size_t& plane0, size_t& plane1)
+{
+    for (size_t i=0; i<word_count; i+=2)
+    {
+        plane0 += __builtin_popcountll(words[i]);
+        plane1 += __builtin_popcountll(words[i+1]);
+    }
+}
+
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+
+// nibble lookup with vpshufb, byte counts summed with vpsadbw: each 256-bit load
+// holds two (plane0, plane1) word pairs, so lanes 0,2 and 1,3 are the two planes
+__attribute__((target("avx2")))
+void plane_popcounts_avx2(const uint64_t* words, size_t word_count, size_t& plane0, size_t& plane1)
+{
+    const __m256i lookup = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                            0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i total = zero;
+
+    size_t i = 0;
+    for (; i+4<=word_count; i+=4)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words+i));
+        const __m256i low = _mm256_and_si256(v, low_mask);
+        const __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        const __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low), _mm256_shuffle_epi8(lookup, high));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(counts, zero));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+    plane0 += lanes[0] + lanes[2];
+    plane1 += lanes[1] + lanes[3];
+
+    plane_popcounts_scalar(words+i, word_count-i, plane0, plane1);
+}
+
+
+#endif
+
+
+PlanePopcounts select_plane_popcounts()
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return plane_popcounts_avx2;
+#endif
+    return plane_popcounts_scalar;
+}
+
+
+void plane_popcounts(const uint64_t* words, size_t word_count, size_t& plane0, size_t& plane1)
+{
+    static const PlanePopcounts kernel = select_plane_popcounts();
+    plane0 = plane1 = 0;
+    kernel(words, word_count, plane0, plane1);
+}
+
+
+} // namespace
+
+
+unsigned int GenotypeData::at(size_t index) const
+{
+    if (index >= size_) throw std::out_of_range("[GenotypeData::at()] Index out of range.");
+    return (*this)[index];
+}
+
+
+void GenotypeData::resize(size_t size)
+{
+    words_.resize(2*word_count(size), 0);
+
+    // keep bits past size() at 0, for popcounts and comparison
+
+    if (size < size_ && size % 64)
+    {
+        const uint64_t mask = (uint64_t(1) << (size % 64)) - 1;
+        words_[words_.size()-2] &= mask;
+        words_[words_.size()-1] &= mask;
+    }
+
+    size_ = size;
+}
+
+
+size_t GenotypeData::allele_count() const
+{
+    size_t plane0 = 0, plane1 = 0;
+    plane_popcounts(words(), words_.size(), plane0, plane1);
+    return plane0 + plane1;
+}
+
+
 double GenotypeData::allele_frequency() const
 {
-    double sum = accumulate(begin(), end(), 0.0);
-    return sum/size()/2;
+    return double(allele_count())/size()/2;
+}
+
+
+void GenotypeData::genotype_counts(size_t counts[3]) const
+{
+    size_t plane0 = 0, plane1 = 0; // genotype >= 1, genotype == 2
+    plane_popcounts(words(), words_.size(), plane0, plane1);
+    counts[0] = size_ - plane0;
+    counts[1] = plane0 - plane1;
+    counts[2] = plane1;
+}
+
+
+double GenotypeData::heterozygosity() const
+{
+    size_t counts[3];
+    genotype_counts(counts);
+    return double(counts[1])/size();
+}
+
+
+bool operator==(const GenotypeData& a, const GenotypeData& b)
+{
+    return a.size() == b.size() &&
+           std::equal(a.words(), a.words() + 2*GenotypeData::word_count(a.size()), b.words());
+}
+
+
+bool operator!=(const GenotypeData& a, const GenotypeData& b)
+{
+    return !(a==b);
+}
+
+
+//
+// SNPIndicator
+//
+
+
+void SNPIndicator::alleles(const DNABlock::EncodedID* chromosome_ids, size_t count,
+                           const Locus& locus, unsigned int* values) const
+{
+    for (size_t i=0; i<count; ++i)
+        values[i] = (*this)(chromosome_ids[i], locus);
 }
 
 
@@ -70,16 +226,138 @@ double GenotypeData::allele_frequency() const
 //
 
 
+namespace {
+
+
+//
+// BlockCursor: finds the blocks containing increasing positions on one chromosome,
+// advancing through the blocks once, so a sweep over L sorted loci costs O(L + B)
+// instead of O(L log B)
+//
+class BlockCursor
+{
+    public:
+
+    BlockCursor() : current_(0), end_(0) {}
+
+    void reset(const Chromosome& chromosome)
+    {
+        const DNABlockSpan blocks = chromosome.blocks();
+        if (blocks.empty()) throw std::runtime_error("[Genotyper::genotype()] Empty chromosome.");
+        current_ = blocks.begin();
+        end_ = blocks.end();
+    }
+
+    // same as Chromosome::find_block(position), for position >= previous position
+    const DNABlock& find_block(unsigned int position)
+    {
+        for (DNABlockSpan::const_iterator next=current_+1; next!=end_ && next->position<=position; ++next)
+            current_ = next;
+        return *current_;
+    }
+
+    private:
+
+    DNABlockSpan::const_iterator current_;
+    DNABlockSpan::const_iterator end_;
+};
+
+
+//
+// OrganismRangeGenotyper: genotypes the organisms of GenotypeData words [begin, end)
+// (64 organisms per word) at all loci, writing into preallocated GenotypeData;
+// used with parallel_for(), so that no two threads write the same word
+//
+// Organisms are taken in batches: for each locus, the block ids of all haplotypes
+// in the batch go to the SNPIndicator in a single call.  Loci are sorted by
+// (chromosome pair, position), so each haplotype is a single sweep with its own
+// BlockCursor.  The SNPIndicator is called once per locus per batch, through
+// alleles(), so indicators that override it (e.g.
+// SNPIndicator_SingleLocusHardyWeinberg) cost one virtual call per batch, not per
+// haplotype.  Indicator is the static type of the indicator: instantiated with a
+// final class (SNPIndicator_Trivial), the call is devirtualized and inlined.
+//
+template <typename Indicator>
+class OrganismRangeGenotyper
+{
+    public:
+
+    OrganismRangeGenotyper(const std::vector<Locus>& loci,
+                           const std::vector<GenotypeData*>& genotypes,
+                           const Organisms& organisms,
+                           const Indicator& indicator)
+    :   loci_(loci), genotypes_(genotypes), organisms_(organisms), indicator_(indicator)
+    {}
+
+    void operator()(size_t range_index, size_t begin, size_t end)
+    {
+        const size_t batch_size = 64 * 16;
+
+        std::vector<BlockCursor> cursors(2*batch_size);
+        std::vector<DNABlock::EncodedID> ids(2*batch_size);
+        std::vector<unsigned int> values(2*batch_size);
+
+        const size_t organism_end = std::min(end*64, organisms_.size());
+
+        for (size_t batch_begin=begin*64; batch_begin<organism_end; batch_begin+=batch_size)
+        {
+            const size_t count = std::min(batch_size, organism_end - batch_begin);
+            size_t current_pair = size_t(-1);
+
+            for (size_t j=0; j<loci_.size(); ++j)
+            {
+                const Locus& locus = loci_[j];
+
+                if (locus.chromosome_pair_index != current_pair)
+                {
+                    current_pair = locus.chromosome_pair_index;
+                    for (size_t k=0; k<count; ++k)
+                    {
+                        const ChromosomePairs& pairs = organisms_[batch_begin+k].chromosomePairs();
+                        if (current_pair >= pairs.size())
+                            throw std::runtime_error("[Genotyper::genotype()] Locus chromosome pair index out of range.");
+
+                        const ChromosomePair& pair = pairs[current_pair];
+                        cursors[2*k].reset(pair.first);
+                        cursors[2*k+1].reset(pair.second);
+                    }
+                }
+
+                for (size_t k=0; k<2*count; ++k)
+                    ids[k] = cursors[k].find_block(locus.position).id;
+
+                indicator_.alleles(&ids[0], 2*count, locus, &values[0]);
+
+                GenotypeData& genotypes = *genotypes_[j];
+                for (size_t k=0; k<count; ++k)
+                    genotypes.set(batch_begin+k, values[2*k] + values[2*k+1]);
+            }
+        }
+    }
+
+    private:
+
+    const std::vector<Locus>& loci_;
+    const std::vector<GenotypeData*>& genotypes_;
+    const Organisms& organisms_;
+    const Indicator& indicator_;
+};
+
+
+} // namespace
+
+
 unsigned int Genotyper::genotype(const Locus& locus, 
                                  const Organism& organism,
                                  const SNPIndicator& indicator) const
 {
+    if (locus.chromosome_pair_index >= organism.chromosomePairs().size())
+        throw std::runtime_error("[Genotyper::genotype()] Locus chromosome pair index out of range.");
+
     const ChromosomePair& cp = organism.chromosomePairs()[locus.chromosome_pair_index];
     const DNABlock& block0 = cp.first.find_block(locus.position);
     const DNABlock& block1 = cp.second.find_block(locus.position);
     return indicator(block0.id, locus) + indicator(block1.id, locus);
-
-    // TODO: add support for parallel iteration with a block index hint
 }
 
 
@@ -88,20 +366,52 @@ GenotypeMapPtr Genotyper::genotype(const Loci& loci,
                                    const SNPIndicator& indicator) const
 {
     GenotypeMapPtr genotype_map(new GenotypeMap);
+    genotype(loci, population, indicator, *genotype_map);
+    return genotype_map;
+}
 
-    for (Loci::const_iterator locus=loci.begin(); locus!=loci.end(); ++locus)
+
+void Genotyper::genotype(const Loci& loci,
+                         const Population& population,
+                         const SNPIndicator& indicator,
+                         GenotypeMap& genotype_map) const
+{
+    for (GenotypeMap::iterator it=genotype_map.begin(); it!=genotype_map.end();)
     {
-        GenotypeDataPtr genotypes(new GenotypeData);
-        genotypes->reserve(population.size());
-        const Organisms& organisms = population.organisms();
+        if (loci.count(it->first))
+            ++it;
+        else
+            genotype_map.erase(it++);
+    }
+
+    // preallocate, so that threads only write into their own slices
+
+    std::vector<Locus> locus_list(loci.begin(), loci.end());
+    std::vector<GenotypeData*> genotype_list;
+    genotype_list.reserve(loci.size());
 
-        for (Organisms::const_iterator organism=organisms.begin(); organism!=organisms.end(); ++organism)
-            genotypes->push_back(genotype(*locus, *organism, indicator));
+    for (Loci::const_iterator locus=loci.begin(); locus!=loci.end(); ++locus)
+    {
+        GenotypeDataPtr& genotypes = genotype_map[*locus];
+        if (!genotypes.get() || genotypes.use_count() != 1)
+            genotypes.reset(new GenotypeData);
 
-        (*genotype_map)[*locus] = genotypes;
+        genotypes->resize(population.size());
+        genotype_list.push_back(genotypes.get());
     }
 
-    return genotype_map;
+    const size_t word_count = GenotypeData::word_count(population.size());
+
+    if (const SNPIndicator_Trivial* trivial = dynamic_cast<const SNPIndicator_Trivial*>(&indicator))
+    {
+        OrganismRangeGenotyper<SNPIndicator_Trivial> range_genotyper(locus_list, genotype_list, population.organisms(), *trivial);
+        parallel_for(word_count, thread_count_, range_genotyper);
+    }
+    else
+    {
+        OrganismRangeGenotyper<SNPIndicator> range_genotyper(locus_list, genotype_list, population.organisms(), indicator);
+        parallel_for(word_count, thread_count_, range_genotyper);
+    }
 }
 
 
@@ -26,6 +26,10 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+#include <stdint.h>
 
 
 struct Locus
@@ -48,14 +52,93 @@ bool operator!=(const Locus& a, const Locus& b);
 std::ostream& operator<<(std::ostream& os, const Locus& locus);
 
 
-class GenotypeData : public std::vector<char> // {0,1,2} for each individual
+//
+// GenotypeData: genotype in {0,1,2} for each individual, bit-packed in two bit
+// planes (2 bits per genotype); the const part of the std::vector interface
+// returns genotype values, and allele counts are popcounts over the planes
+//
+class GenotypeData
 {
     public:
 
+    typedef unsigned int value_type;
+
+    class const_iterator
+    {
+        public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef unsigned int value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const unsigned int* pointer;
+        typedef unsigned int reference;
+
+        const_iterator(const GenotypeData* data = 0, size_t index = 0) : data_(data), index_(index) {}
+        unsigned int operator*() const {return (*data_)[index_];}
+        const_iterator& operator++() {++index_; return *this;}
+        const_iterator operator++(int) {const_iterator result(*this); ++index_; return result;}
+        bool operator==(const const_iterator& that) const {return index_ == that.index_;}
+        bool operator!=(const const_iterator& that) const {return index_ != that.index_;}
+
+        private:
+        const GenotypeData* data_;
+        size_t index_;
+    };
+
+    GenotypeData(size_t size = 0) : size_(0) {resize(size);}
+
+    size_t size() const {return size_;}
+    bool empty() const {return size_ == 0;}
+    const_iterator begin() const {return const_iterator(this, 0);}
+    const_iterator end() const {return const_iterator(this, size_);}
+
+    unsigned int operator[](size_t index) const
+    {
+        const uint64_t* word = &words_[2*(index/64)];
+        const unsigned int bit = index % 64;
+        return unsigned(word[0] >> bit & 1) + unsigned(word[1] >> bit & 1);
+    }
+
+    unsigned int at(size_t index) const;
+
+    // genotype value in {0,1,2}; individuals in different 64-bit words may be set
+    // concurrently
+    void set(size_t index, unsigned int genotype)
+    {
+        uint64_t* word = &words_[2*(index/64)];
+        const uint64_t mask = uint64_t(1) << (index % 64);
+        word[0] = genotype >= 1 ? word[0] | mask : word[0] & ~mask;
+        word[1] = genotype == 2 ? word[1] | mask : word[1] & ~mask;
+    }
+
+    void push_back(unsigned int genotype) {resize(size_+1); set(size_-1, genotype);}
+    void resize(size_t size); // new genotypes are 0
+    void reserve(size_t size) {words_.reserve(2*word_count(size));}
+    void clear() {resize(0);}
+
+    // column statistics, by popcount over the bit planes (AVX2 when the cpu has it):
+    // sum of genotypes, allele_count()/(2*size()), the number of individuals with
+    // genotype 0/1/2, and the fraction of heterozygotes
+    size_t allele_count() const;
     double allele_frequency() const;
+    void genotype_counts(size_t counts[3]) const;
+    double heterozygosity() const;
+
+    // bit planes, interleaved: words()[2*k] has bit j set iff genotype 64k+j >= 1,
+    // words()[2*k+1] iff it is 2 (bits past size() are 0)
+    const uint64_t* words() const {return words_.empty() ? 0 : &words_[0];}
+    static size_t word_count(size_t size) {return (size+63)/64;}
+
+    private:
+
+    size_t size_;
+    std::vector<uint64_t> words_;
 };
 
 
+bool operator==(const GenotypeData& a, const GenotypeData& b);
+bool operator!=(const GenotypeData& a, const GenotypeData& b);
+
+
 typedef shared_ptr<GenotypeData> GenotypeDataPtr;
 typedef std::map<Locus, GenotypeDataPtr> GenotypeMap;
 typedef shared_ptr<GenotypeMap> GenotypeMapPtr;
@@ -66,7 +149,14 @@ class SNPIndicator
     public:
 
     // return value in {0, 1}
-    virtual unsigned int operator()(unsigned int chromosome_id, const Locus& locus) const = 0;
+    virtual unsigned int operator()(DNABlock::EncodedID chromosome_id, const Locus& locus) const = 0;
+
+    // batch version for a single locus: values[i] = (*this)(chromosome_ids[i], locus);
+    // the default calls operator() for each id, implementations override it to
+    // avoid a virtual call per haplotype
+    virtual void alleles(const DNABlock::EncodedID* chromosome_ids, size_t count,
+                         const Locus& locus, unsigned int* values) const;
+
     virtual ~SNPIndicator() {}
 };
 
@@ -74,17 +164,31 @@ class SNPIndicator
 typedef shared_ptr<SNPIndicator> SNPIndicatorPtr;
 
 
-class SNPIndicator_Trivial : public SNPIndicator
+class SNPIndicator_Trivial final : public SNPIndicator
 {
     public:
-    virtual unsigned int operator()(unsigned int chromosome_id, const Locus& locus) const {return 0;}
+    virtual unsigned int operator()(DNABlock::EncodedID chromosome_id, const Locus& locus) const {return 0;}
+
+    virtual void alleles(const DNABlock::EncodedID* chromosome_ids, size_t count,
+                         const Locus& locus, unsigned int* values) const
+    {
+        std::fill(values, values+count, 0u);
+    }
 };
 
 
+//
+// Genotyper: with thread_count > 1, population genotyping is split into organism
+// ranges, one per thread, each filling its slice of every locus's GenotypeData;
+// the result is the same as the serial one, and the SNPIndicator must allow
+// concurrent calls
+//
 class Genotyper
 {
     public:
 
+    Genotyper(size_t thread_count = 1) : thread_count_(thread_count) {}
+
     // returns genotype value in {0, 1, 2}, for a single organism at a single locus
     unsigned int genotype(const Locus& locus, 
                           const Organism& organism,
@@ -94,6 +198,17 @@ class Genotyper
     GenotypeMapPtr genotype(const Loci& loci, 
                             const Population& population,
                             const SNPIndicator& indicator) const;
+
+    // same, into genotype_map, reusing the GenotypeData of loci already present
+    // that nothing else holds
+    void genotype(const Loci& loci,
+                  const Population& population,
+                  const SNPIndicator& indicator,
+                  GenotypeMap& genotype_map) const;
+
+    private:
+
+    size_t thread_count_;
 };
 
 
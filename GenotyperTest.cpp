@@ -21,6 +21,8 @@
 #include "unit.hpp"
 #include <iostream>
 #include <iterator>
+#include <cstring>
+#include <stdexcept>
 
 
 using namespace std;
@@ -34,7 +36,7 @@ class SNPIndicator_Test : public SNPIndicator
 {
     public:
 
-    virtual unsigned int operator()(unsigned int chromosome_id, const Locus& locus) const
+    virtual unsigned int operator()(DNABlock::EncodedID chromosome_id, const Locus& locus) const
     {
         Chromosome::ID id(chromosome_id);
         return (id.population == 0) ? 0 : 1;
@@ -158,6 +160,193 @@ void test_genotype_harder()
     unit_assert(genotypes->at(0) == 0 && genotypes->at(3) == 0);
     unit_assert(genotypes->at(1) == 2 && genotypes->at(4) == 2);
     unit_assert(genotypes->at(2) == 1 && genotypes->at(5) == 1);
+
+    // genotyping into an existing map: unshared GenotypeData is reused, stale loci dropped
+
+    Locus stale(0, 5);
+    (*genotype_map)[stale] = GenotypeDataPtr(new GenotypeData);
+    genotypes.reset();
+
+    const GenotypeData* reused_address = genotype_map->at(locus).get();
+    genotyper.genotype(loci, population, indicator, *genotype_map);
+    unit_assert(genotype_map->size() == 1 && !genotype_map->count(stale));
+    unit_assert(genotype_map->at(locus).get() == reused_address);
+    unit_assert(genotype_map->at(locus)->size() == 6 && genotype_map->at(locus)->at(1) == 2);
+
+    GenotypeDataPtr held = genotype_map->at(locus);
+    genotyper.genotype(loci, population, indicator, *genotype_map);
+    unit_assert(genotype_map->at(locus) != held);
+    unit_assert(*genotype_map->at(locus) == *held);
+}
+
+
+void test_genotype_parallel()
+{
+    if (os_) *os_ << "test_genotype_parallel()\n";
+
+    vector<string> filenames(2, "genetic_map_chr21_b36.txt");
+    Random random_map;
+
+    Organism::recombinationPositionGenerator_ =
+        shared_ptr<RecombinationPositionGenerator>(
+            new RecombinationPositionGenerator_RecombinationMap(filenames, random_map));
+
+    Population::Config config0;
+    config0.size = 40;
+    config0.chromosomePairCount = 2;
+    config0.populationID = 1;
+
+    Population::Config config0b(config0);
+    config0b.populationID = 0;
+
+    PopulationPtrs founders;
+    founders.push_back(PopulationPtr(new Population));
+    founders.back()->create_organisms(config0);
+    founders.push_back(PopulationPtr(new Population));
+    founders.back()->create_organisms(config0b);
+
+    Population::Config config1;
+    config1.size = 101;
+    config1.matingDistribution.push_back(1, make_pair(0,1));
+
+    PopulationPtrs admixed;
+    admixed.push_back(PopulationPtr(new Population));
+    admixed.back()->create_organisms(config1, founders, DataVectorPtrs(2), Random(7));
+
+    Population::Config config2;
+    config2.size = 101;
+    config2.matingDistribution.push_back(1, make_pair(0,0));
+
+    Population population; // mixture of 0/1/2 genotypes
+    population.create_organisms(config2, admixed, DataVectorPtrs(1), Random(8));
+
+    Loci loci;
+    for (unsigned int position=15000000; position<47000000; position+=1000000)
+    {
+        loci.insert(Locus(0, position));
+        loci.insert(Locus(1, position + 500000));
+    }
+
+    SNPIndicator_Test indicator;
+    Genotyper genotyper;
+    GenotypeMapPtr serial = genotyper.genotype(loci, population, indicator);
+
+    // sweep over sorted loci agrees with single-locus lookups
+
+    for (GenotypeMap::const_iterator it=serial->begin(); it!=serial->end(); ++it)
+    for (size_t i=0; i<population.size(); ++i)
+        unit_assert(size_t(it->second->at(i)) == genotyper.genotype(it->first, population.organisms()[i], indicator));
+
+    const size_t thread_counts[] = {2, 3, 8};
+    for (size_t i=0; i<3; ++i)
+    {
+        GenotypeMapPtr parallel = Genotyper(thread_counts[i]).genotype(loci, population, indicator);
+        unit_assert(parallel->size() == loci.size());
+
+        for (GenotypeMap::const_iterator it=serial->begin(); it!=serial->end(); ++it)
+            unit_assert(*parallel->at(it->first) == *it->second);
+    }
+
+    // batch interface: default implementation, and the built-in trivial indicator
+
+    vector<DNABlock::EncodedID> ids;
+    ids.push_back(Chromosome::ID(0, 3, 0, 0));
+    ids.push_back(Chromosome::ID(1, 3, 0, 1));
+    ids.push_back(Chromosome::ID(1, 5, 1, 0));
+    vector<unsigned int> values(ids.size(), 7);
+    indicator.alleles(&ids[0], ids.size(), *loci.begin(), &values[0]);
+    unit_assert(values[0] == 0 && values[1] == 1 && values[2] == 1);
+
+    GenotypeMapPtr trivial = genotyper.genotype(loci, population, SNPIndicator_Trivial());
+    for (GenotypeMap::const_iterator it=trivial->begin(); it!=trivial->end(); ++it)
+        unit_assert(it->second->size() == population.size() && it->second->allele_count() == 0);
+
+    size_t counts[3] = {0, 0, 0};
+    for (GenotypeMap::const_iterator it=serial->begin(); it!=serial->end(); ++it)
+    {
+        unit_assert(it->second->size() == population.size());
+        for (GenotypeData::const_iterator g=it->second->begin(); g!=it->second->end(); ++g)
+            counts[size_t(*g)]++;
+    }
+
+    if (os_) *os_ << "genotype counts: " << counts[0] << " " << counts[1] << " " << counts[2] << endl;
+    unit_assert(counts[0] && counts[1] && counts[2]);
+
+    Organism::recombinationPositionGenerator_ = shared_ptr<RecombinationPositionGenerator>();
+}
+
+
+void test_genotype_data()
+{
+    if (os_) *os_ << "test_genotype_data()\n";
+
+    // 2 bits per genotype, across word boundaries
+
+    GenotypeData data(130);
+    unit_assert(data.size() == 130 && GenotypeData::word_count(data.size()) == 3);
+    for (size_t i=0; i<data.size(); ++i)
+        data.set(i, i%3);
+
+    for (size_t i=0; i<data.size(); ++i)
+        unit_assert(data[i] == i%3);
+
+    data.set(64, 2);
+    data.set(64, 1);
+    unit_assert(data[64] == 1 && data[63] == 0 && data[65] == 2);
+    unit_assert_throws(data.at(130), out_of_range);
+
+    vector<unsigned int> values(data.begin(), data.end());
+    unit_assert(values.size() == 130 && values[128] == 2);
+
+    size_t sum = 0;
+    for (size_t i=0; i<data.size(); ++i) sum += data[i];
+    unit_assert(data.allele_count() == sum);
+
+    // shrinking drops the tail, so growing again gives 0s
+
+    GenotypeData copy(data);
+    unit_assert(copy == data);
+    copy.resize(70);
+    copy.resize(130);
+    unit_assert(copy != data);
+    for (size_t i=70; i<130; ++i) unit_assert(copy[i] == 0);
+    for (size_t i=0; i<70; ++i) unit_assert(copy[i] == data[i]);
+
+    copy.clear();
+    unit_assert(copy.empty() && copy.allele_count() == 0);
+}
+
+
+void test_genotype_statistics()
+{
+    if (os_) *os_ << "test_genotype_statistics()\n";
+
+    // sizes around the vector kernel's 128-individual stride
+
+    const size_t sizes[] = {1, 63, 64, 127, 128, 129, 1000, 4099};
+
+    for (size_t n=0; n<8; ++n)
+    {
+        Random random(n);
+        GenotypeData data(sizes[n]);
+        size_t expected[3] = {0, 0, 0};
+
+        for (size_t i=0; i<data.size(); ++i)
+        {
+            unsigned int genotype = random.randint(0, 2);
+            data.set(i, genotype);
+            expected[genotype]++;
+        }
+
+        size_t counts[3];
+        data.genotype_counts(counts);
+        unit_assert(counts[0] == expected[0] && counts[1] == expected[1] && counts[2] == expected[2]);
+        unit_assert(data.allele_count() == expected[1] + 2*expected[2]);
+
+        const double epsilon = 1e-12;
+        unit_assert_equal(data.heterozygosity(), double(expected[1])/sizes[n], epsilon);
+        unit_assert_equal(data.allele_frequency(), double(expected[1] + 2*expected[2])/sizes[n]/2, epsilon);
+    }
 }
 
 
@@ -175,10 +364,48 @@ void test_allele_frequency()
 }
 
 
+void test_genotype_bounds()
+{
+    if (os_) *os_ << "test_genotype_bounds()\n";
+
+    SNPIndicator_Test indicator;
+    Genotyper genotyper;
+
+    // locus on a chromosome pair the organisms don't have
+
+    Organisms organisms(3, Organism(Chromosome::ID(0, 0, 0, 0), 2));
+    Population population(organisms);
+
+    Loci loci;
+    loci.insert(Locus(1, 1000));
+    unit_assert(genotyper.genotype(loci, population, indicator)->size() == 1);
+    unit_assert_throws(genotyper.genotype(Locus(2, 1000), organisms[0], indicator), runtime_error);
+
+    loci.insert(Locus(2, 1000));
+    unit_assert_throws(genotyper.genotype(loci, population, indicator), runtime_error);
+
+    // empty chromosome
+
+    Organism::Gamete g1(1, Chromosome(Chromosome::ID(0, 0, 0, 0)));
+    Organism::Gamete g2(1, Chromosome());
+    organisms.push_back(Organism(g1, g2));
+    Population population_empty(organisms);
+
+    loci.clear();
+    loci.insert(Locus(0, 1000));
+    unit_assert_throws(genotyper.genotype(loci, population_empty, indicator), runtime_error);
+    unit_assert_throws(genotyper.genotype(Locus(0, 1000), organisms.back(), indicator), runtime_error);
+}
+
+
 void test()
 {
     test_genotype_easy();
     test_genotype_harder();
+    test_genotype_parallel();
+    test_genotype_bounds();
+    test_genotype_data();
+    test_genotype_statistics();
     test_allele_frequency();
 }
 
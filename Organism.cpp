@@ -22,6 +22,8 @@
 #include <stdexcept>
 #include <sstream>
 #include <iterator>
+#include <algorithm>
+#include <map>
 
 
 using namespace std;
@@ -32,34 +34,69 @@ using namespace std;
 //
 
 vector<unsigned int> RecombinationPositionGenerator_Trivial::get_positions(size_t index) const
+{
+    return get_positions(index, random_);
+}
+
+
+vector<unsigned int> RecombinationPositionGenerator_Trivial::get_positions(size_t index, const Random& random) const
 {
     vector<unsigned int> result;
-    if (random_.random()>=.5) result.push_back(0); // start with 2nd chromosome
+    get_positions(index, random, result);
     return result;
 }
 
 
+void RecombinationPositionGenerator_Trivial::get_positions(size_t index, const Random& random, vector<unsigned int>& positions) const
+{
+    positions.clear();
+    if (random.random()>=.5) positions.push_back(0); // start with 2nd chromosome
+}
+
+
 vector<unsigned int> RecombinationPositionGenerator_RecombinationMap::get_positions(size_t index) const
 {
-    if (index >= recombinationMaps_.size())
-        throw runtime_error("[RecombinationPositionGenerator_RecombinationMap::get_positions()] Index out of bounds.");
+    return get_positions(index, random_);
+}
 
-    vector<unsigned int> positions = recombinationMaps_[index]->random_positions(); // may not be sorted 
-    if (random_.random()>=.5) positions.push_back(0); // start with 2nd chromosome
-    sort(positions.begin(), positions.end());
 
+vector<unsigned int> RecombinationPositionGenerator_RecombinationMap::get_positions(size_t index, const Random& random) const
+{
+    vector<unsigned int> positions;
+    get_positions(index, random, positions);
     return positions; 
 }
 
 
+void RecombinationPositionGenerator_RecombinationMap::get_positions(size_t index, const Random& random, vector<unsigned int>& positions) const
+{
+    if (index >= recombinationMaps_.size())
+        throw runtime_error("[RecombinationPositionGenerator_RecombinationMap::get_positions()] Index out of bounds.");
+
+    recombinationMaps_[index]->random_positions(random, positions); // sorted
+    if (random.random()>=.5) positions.insert(positions.begin(), 0); // start with 2nd chromosome
+}
+
+
 RecombinationPositionGenerator_RecombinationMap::RecombinationPositionGenerator_RecombinationMap(
         const vector<string>& filenames,
         const Random& random)
 :   random_(random)
 {
+    // chromosome pairs that name the same file share a single map
+
+    map< string, shared_ptr<RecombinationMap> > loaded;
+
     for (vector<string>::const_iterator it=filenames.begin(); it!=filenames.end(); ++it)
-        recombinationMaps_.push_back(shared_ptr<RecombinationMap>(
-            new RecombinationMap(*it, random)));
+    {
+        shared_ptr<RecombinationMap>& recombinationMap = loaded[*it];
+        if (!recombinationMap.get())
+        {
+            recombinationMap.reset(new RecombinationMap(*it, random));
+            recombinationMap->build_index();
+        }
+        recombinationMaps_.push_back(recombinationMap);
+    }
 }
 
 
@@ -71,7 +108,7 @@ RecombinationPositionGenerator_RecombinationMap::RecombinationPositionGenerator_
 shared_ptr<RecombinationPositionGenerator> Organism::recombinationPositionGenerator_; // static storage
 
 
-Organism::Organism(unsigned int id, size_t chromosomeCount)
+Organism::Organism(DNABlock::EncodedID id, size_t chromosomeCount)
 {
     Chromosome::ID id0(id);
     Chromosome::ID id1(id);
@@ -97,6 +134,24 @@ Organism::Organism(const Gamete& g1, const Gamete& g2)
 
 
 Organism::Organism(const Organism& mom, const Organism& dad)
+{
+    recombine(mom, dad, 0);
+}
+
+
+Organism::Organism(const Organism& mom, const Organism& dad, const Random& random)
+{
+    recombine(mom, dad, &random);
+}
+
+
+void Organism::assign(const Organism& mom, const Organism& dad, const Random& random)
+{
+    recombine(mom, dad, &random);
+}
+
+
+void Organism::recombine(const Organism& mom, const Organism& dad, const Random* random)
 {
     if (!recombinationPositionGenerator_.get())
         throw runtime_error("[Organism::Organism(mom, dad)] No RecombinationPositionGenerator.");
@@ -104,18 +159,32 @@ Organism::Organism(const Organism& mom, const Organism& dad)
     if (mom.chromosomePairs_.size() != dad.chromosomePairs_.size())
         throw runtime_error("[Organism::Organism(mom, dad)] Parents chromosome counts differ.");
 
+    this->chromosomePairs_.clear();
     this->chromosomePairs_.reserve(mom.chromosomePairs_.size());
 
+    // position buffers are reused by all offspring created on this thread
+
+    static thread_local vector<unsigned int> positions_mom;
+    static thread_local vector<unsigned int> positions_dad;
+
     size_t chromosome_index = 0;
     for (ChromosomePairs::const_iterator it=mom.chromosomePairs_.begin(), jt=dad.chromosomePairs_.begin();
          it!=mom.chromosomePairs_.end(); ++it, ++jt, ++chromosome_index)
     {
-        vector<unsigned int> positions_mom = recombinationPositionGenerator_->get_positions(chromosome_index);
-        vector<unsigned int> positions_dad = recombinationPositionGenerator_->get_positions(chromosome_index);
+        if (random)
+        {
+            recombinationPositionGenerator_->get_positions(chromosome_index, *random, positions_mom);
+            recombinationPositionGenerator_->get_positions(chromosome_index, *random, positions_dad);
+        }
+        else
+        {
+            positions_mom = recombinationPositionGenerator_->get_positions(chromosome_index);
+            positions_dad = recombinationPositionGenerator_->get_positions(chromosome_index);
+        }
 
-        this->chromosomePairs_.push_back(make_pair(
+        this->chromosomePairs_.emplace_back(
             Chromosome(it->first, it->second, positions_mom),
-            Chromosome(jt->first, jt->second, positions_dad)));
+            Chromosome(jt->first, jt->second, positions_dad));
     }
 }
 
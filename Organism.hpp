@@ -34,6 +34,21 @@ class RecombinationPositionGenerator
 {
     public:
     virtual std::vector<unsigned int> get_positions(size_t index = 0) const = 0;
+
+    // same, but drawing from the caller's Random, so that concurrent callers can use
+    // independent streams; default implementation ignores random (not thread-safe)
+    virtual std::vector<unsigned int> get_positions(size_t index, const Random& random) const
+    {
+        return get_positions(index);
+    }
+
+    // same, writing sorted positions into a caller-owned buffer that is reused across
+    // calls; implementations override this to avoid allocation
+    virtual void get_positions(size_t index, const Random& random, std::vector<unsigned int>& positions) const
+    {
+        positions = get_positions(index, random);
+    }
+
     virtual ~RecombinationPositionGenerator(){}
 };
 
@@ -49,6 +64,8 @@ class RecombinationPositionGenerator_Trivial : public RecombinationPositionGener
     RecombinationPositionGenerator_Trivial(const Random& random) : random_(random) {};
 
     virtual std::vector<unsigned int> get_positions(size_t index) const;
+    virtual std::vector<unsigned int> get_positions(size_t index, const Random& random) const;
+    virtual void get_positions(size_t index, const Random& random, std::vector<unsigned int>& positions) const;
 
     private:
     const Random& random_;
@@ -62,10 +79,13 @@ class RecombinationPositionGenerator_RecombinationMap : public RecombinationPosi
 { 
     public:
 
+    // filenames: one per chromosome pair, text or binary (see RecombinationMap)
     RecombinationPositionGenerator_RecombinationMap(const std::vector<std::string>& filenames,
                                                     const Random& random);
 
     virtual std::vector<unsigned int> get_positions(size_t index) const;
+    virtual std::vector<unsigned int> get_positions(size_t index, const Random& random) const;
+    virtual void get_positions(size_t index, const Random& random, std::vector<unsigned int>& positions) const;
 
     private:
     const Random& random_;
@@ -81,10 +101,21 @@ class Organism
 
     typedef std::vector<Chromosome> Gamete;
 
-    Organism(unsigned int id = 0, size_t chromosomeCount = 1);
+    Organism(DNABlock::EncodedID id = 0, size_t chromosomeCount = 1);
     Organism(const Gamete& g1, const Gamete& g2);
     Organism(const Organism& mom, const Organism& dad);
 
+    // same, with recombination positions drawn from the specified Random
+    // (for creating offspring concurrently with per-thread Random streams)
+    Organism(const Organism& mom, const Organism& dad, const Random& random);
+
+    // replace with an offspring of mom and dad, reusing this organism's storage
+    // (mom and dad must be other organisms)
+    void assign(const Organism& mom, const Organism& dad, const Random& random);
+
+    // drop the chromosomes, keeping the storage for the next assign()
+    void clear() {chromosomePairs_.clear();}
+
     const ChromosomePairs& chromosomePairs() const {return chromosomePairs_;}
 
     Gamete create_gamete() const;
@@ -95,6 +126,8 @@ class Organism
 
     private:
     ChromosomePairs chromosomePairs_;
+
+    void recombine(const Organism& mom, const Organism& dad, const Random* random);
 };
 
 
@@ -0,0 +1,103 @@
+//
+// Parallel.hpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+
+#ifndef _PARALLEL_HPP_
+#define _PARALLEL_HPP_
+
+
+#include <vector>
+#include <thread>
+#include <exception>
+#include <algorithm>
+
+
+//
+// parallel_for: splits [0, count) into thread_count contiguous ranges and
+// calls f(range_index, begin, end) for each range on its own thread;
+// with thread_count <= 1, f(0, 0, count) is called on the calling thread
+//
+// Ranges are deterministic for a given (count, thread_count), so per-range
+// state (e.g. random streams) gives reproducible results.  An exception
+// thrown by f is rethrown in the calling thread after all ranges finish.
+//
+
+
+namespace parallel_detail {
+
+template <typename Function>
+struct RangeRunner
+{
+    Function* f;
+    size_t range_index;
+    size_t begin;
+    size_t end;
+    std::exception_ptr* error;
+
+    void operator()() const
+    {
+        try
+        {
+            (*f)(range_index, begin, end);
+        }
+        catch (...)
+        {
+            *error = std::current_exception();
+        }
+    }
+};
+
+} // namespace parallel_detail
+
+
+template <typename Function>
+void parallel_for(size_t count, size_t thread_count, Function& f)
+{
+    thread_count = std::min(thread_count, count);
+
+    if (thread_count <= 1)
+    {
+        f(0, 0, count);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(thread_count);
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+
+    for (size_t i=0; i<thread_count; ++i)
+    {
+        parallel_detail::RangeRunner<Function> runner;
+        runner.f = &f;
+        runner.range_index = i;
+        runner.begin = count * i / thread_count;
+        runner.end = count * (i+1) / thread_count;
+        runner.error = &errors[i];
+        threads.push_back(std::thread(runner));
+    }
+
+    for (std::vector<std::thread>::iterator it=threads.begin(); it!=threads.end(); ++it)
+        it->join();
+
+    for (std::vector<std::exception_ptr>::const_iterator it=errors.begin(); it!=errors.end(); ++it)
+        if (*it) std::rethrow_exception(*it);
+}
+
+
+#endif //  _PARALLEL_HPP_
+
@@ -0,0 +1,120 @@
+//
+// ParallelTest.cpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+
+#include "Parallel.hpp"
+#include "unit.hpp"
+#include <iostream>
+#include <iterator>
+#include <cstring>
+
+
+using namespace std;
+
+
+ostream* os_ = 0;
+//ostream* os_ = &cout;
+
+
+struct FillRangeIndex
+{
+    vector<size_t>& result;
+    FillRangeIndex(vector<size_t>& _result) : result(_result) {}
+
+    void operator()(size_t range_index, size_t begin, size_t end)
+    {
+        for (size_t i=begin; i<end; ++i)
+            result[i] = range_index;
+    }
+};
+
+
+void test_ranges()
+{
+    if (os_) *os_ << "test_ranges()\n";
+
+    const size_t count = 10;
+
+    for (size_t thread_count=0; thread_count<=12; ++thread_count)
+    {
+        vector<size_t> result(count, count);
+        FillRangeIndex f(result);
+        parallel_for(count, thread_count, f);
+
+        if (os_)
+        {
+            *os_ << thread_count << ": ";
+            copy(result.begin(), result.end(), ostream_iterator<size_t>(*os_, " "));
+            *os_ << endl;
+        }
+
+        // every slot filled, ranges contiguous and in order
+
+        unit_assert(result.front() == 0);
+        for (size_t i=1; i<count; ++i)
+            unit_assert(result[i] == result[i-1] || result[i] == result[i-1] + 1);
+        unit_assert(result.back() == max(min(thread_count, count), size_t(1)) - 1);
+    }
+}
+
+
+struct ThrowOnRange
+{
+    void operator()(size_t range_index, size_t begin, size_t end)
+    {
+        if (range_index == 2) throw runtime_error("range 2");
+    }
+};
+
+
+void test_exception()
+{
+    if (os_) *os_ << "test_exception()\n";
+    ThrowOnRange f;
+    unit_assert_throws_what(parallel_for(100, 4, f), runtime_error, "range 2");
+}
+
+
+void test()
+{
+    test_ranges();
+    test_exception();
+}
+
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
+        test();
+        return 0;
+    }
+    catch(exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Caught unknown exception.\n";
+        return 1;
+    }
+}
+
+
@@ -19,6 +19,7 @@
 
 #include "Population.hpp"
 #include "Random.hpp"
+#include "Parallel.hpp"
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
@@ -26,6 +27,8 @@
 #include <set>
 #include <fstream>
 #include <cmath>
+#include <algorithm>
+#include <numeric>
 
 
 using namespace std;
@@ -39,7 +42,7 @@ using namespace std;
 namespace {
 struct HasLowerWeight
 {
-    bool operator()(const MatingDistribution::Entry& a, const MatingDistribution::Entry& b) 
+    bool operator()(const MatingDistribution::Entry& a, const MatingDistribution::Entry& b) const
     {
         return a.cumulativeWeight < b.cumulativeWeight;
     }
@@ -51,11 +54,35 @@ void MatingDistribution::push_back(double weight, const IndexPair& indexPair)
 {
     totalWeight_ += weight;
     entries_.push_back(Entry(totalWeight_, indexPair));
+    aliasTable_.reset();
 }
 
 
-const MatingDistribution::IndexPair& MatingDistribution::random_index_pair(const Random& random) const
+shared_ptr<const AliasTable> MatingDistribution::alias_table() const
 {
+    // offspring threads may make the first draw at the same time: each builds a
+    // table, and the first one published is used by all
+
+    shared_ptr<const AliasTable> result = atomic_load(&aliasTable_);
+    if (result.get()) return result;
+
+    vector<double> weights;
+    for (Entries::const_iterator it=entries_.begin(); it!=entries_.end(); ++it)
+        weights.push_back(it->cumulativeWeight - (it==entries_.begin() ? 0 : (it-1)->cumulativeWeight));
+
+    shared_ptr<const AliasTable> table(new AliasTable(weights));
+    shared_ptr<const AliasTable> expected;
+    return atomic_compare_exchange_strong(&aliasTable_, &expected, table) ? table : expected;
+}
+
+
+const MatingDistribution::IndexPair& MatingDistribution::random_index_pair(const Random& random, Sampler sampler) const
+{
+    // zero total weight: binary search only, as before alias tables
+
+    if (sampler == Sampler_AliasTable && totalWeight_ > 0)
+        return entries_[alias_table()->random_index(random)].indexPair;
+
     double roll = random.uniform(0, totalWeight_);
 
     vector<Entry>::const_iterator it = lower_bound(entries_.begin(), entries_.end(),
@@ -179,12 +206,23 @@ class RandomOrganismIndexGenerator
 
     RandomOrganismIndexGenerator(const Population& p,
                                  const DataVectorPtr& fitness_vector,
-                                 const Random& random)
+                                 Sampler sampler)
     :   population_size_(p.organisms().size()),
-        fitness_cdf_max_(0),
-        random_(random)
+        fitness_cdf_max_(0)
     {
-        if (fitness_vector.get()) 
+        if (!fitness_vector.get())
+            return;
+
+        if (fitness_vector->size() != population_size_)
+            throw runtime_error("[RandomOrganismIndexGenerator] Fitness vector size != population size.");
+
+        const double total = accumulate(fitness_vector->begin(), fitness_vector->end(), 0.0);
+
+        if (sampler == Sampler_AliasTable && total > 0)
+        {
+            fitness_alias_table_ = AliasTable(*fitness_vector); // O(N), once per generation
+        }
+        else
         {
             fitness_cdf_ = fitness_vector->cdf(); // memory allocation for cdf
 
@@ -195,31 +233,125 @@ class RandomOrganismIndexGenerator
         }
     }
 
-    size_t operator()() const
+    size_t operator()(const Random& random) const
     {
-        if (!fitness_cdf_.get()) 
+        if (!fitness_alias_table_.empty())
         {
-            return random_.randint(0, population_size_-1); // uniform random index
+            // pick random index according to fitnesses, O(1)
+            return fitness_alias_table_.random_index(random);
         }
-        else
+        else if (fitness_cdf_.get())
         {
-            // pick random index according to fitnesses
-            double roll = random_.uniform(0, fitness_cdf_max_);
+            // pick random index according to fitnesses, O(log N)
+            double roll = random.uniform(0, fitness_cdf_max_);
             DataVector::const_iterator it = lower_bound(fitness_cdf_->begin(), fitness_cdf_->end(), roll);
             return it - fitness_cdf_->begin();
         }
+        else
+        {
+            return random.randint(0, population_size_-1); // uniform random index
+        }
     }
 
     private:
 
     size_t population_size_;
+    AliasTable fitness_alias_table_;
     DataVectorPtr fitness_cdf_;
     double fitness_cdf_max_;
-    const Random& random_;
 };
 
 
 typedef shared_ptr<RandomOrganismIndexGenerator> RandomOrganismIndexGeneratorPtr;
+typedef vector<RandomOrganismIndexGeneratorPtr> RandomOrganismIndexGeneratorPtrs;
+
+
+// pick the parents of a single offspring
+pair<const Organism*, const Organism*> random_parents(const Population::Config& config,
+                                                      const PopulationPtrs& populations,
+                                                      const RandomOrganismIndexGeneratorPtrs& random_organism_index_generators,
+                                                      const Random& random,
+                                                      Sampler sampler)
+{
+    const MatingDistribution::IndexPair& parentIndices = config.matingDistribution.random_index_pair(random, sampler);
+
+    if (max(parentIndices.first,parentIndices.second) >= populations.size())
+        throw runtime_error("[Population::Population()] Indices out of bounds.");
+
+    if (populations[parentIndices.first]->organisms().empty() ||
+        populations[parentIndices.second]->organisms().empty())
+        throw runtime_error("[Population::Population()] Empty population.");
+
+    size_t index1 = (*random_organism_index_generators[parentIndices.first])(random);
+    size_t index2 = 0;
+    do { // avoid selfing
+        index2 = (*random_organism_index_generators[parentIndices.second])(random);
+    } while (parentIndices.first == parentIndices.second && index1 == index2);
+
+    const Organism& mom = populations[parentIndices.first]->organisms()[index1];
+    const Organism& dad = populations[parentIndices.second]->organisms()[index2];
+    return make_pair(&mom, &dad);
+}
+
+
+unsigned int random_seed(const Random& random)
+{
+    return static_cast<unsigned int>(random.random() * 4294967296.0);
+}
+
+
+//
+// OffspringCreator: creates the offspring for a range of slots [begin, end) of the
+// new population, in place; used with parallel_for(), one range per thread
+//
+// Each offspring draws from its own Random stream, keyed by (stream_seed, slot index),
+// so the result doesn't depend on the number of threads or on scheduling.
+//
+class OffspringCreator
+{
+    public:
+
+    OffspringCreator(const Population::Config& config,
+                     const PopulationPtrs& populations,
+                     const RandomOrganismIndexGeneratorPtrs& random_organism_index_generators,
+                     unsigned int stream_seed,
+                     Sampler sampler,
+                     Organism* offspring,
+                     const vector< shared_ptr<BlockArena> >& arenas)
+    :   config_(config), populations_(populations),
+        random_organism_index_generators_(random_organism_index_generators),
+        stream_seed_(stream_seed), sampler_(sampler), offspring_(offspring), arenas_(arenas)
+    {}
+
+    void operator()(size_t range_index, size_t begin, size_t end)
+    {
+        // blocks of this range's offspring go into one arena, shared by no other thread
+
+        BlockArena::Scope scope(*arenas_[range_index]);
+
+        // one Random per range, rekeyed for each offspring's stream
+
+        Random random;
+
+        for (size_t i=begin; i<end; ++i)
+        {
+            random.seed(stream_seed_, static_cast<unsigned int>(i));
+            pair<const Organism*, const Organism*> parents =
+                random_parents(config_, populations_, random_organism_index_generators_, random, sampler_);
+            offspring_[i].assign(*parents.first, *parents.second, random);
+        }
+    }
+
+    private:
+
+    const Population::Config& config_;
+    const PopulationPtrs& populations_;
+    const RandomOrganismIndexGeneratorPtrs& random_organism_index_generators_;
+    unsigned int stream_seed_;
+    Sampler sampler_;
+    Organism* offspring_;
+    const vector< shared_ptr<BlockArena> >& arenas_;
+};
 
 
 } // namespace
@@ -228,7 +360,9 @@ typedef shared_ptr<RandomOrganismIndexGenerator> RandomOrganismIndexGeneratorPtr
 void Population::create_organisms(const Config& config,
                                   const PopulationPtrs& populations,
                                   const DataVectorPtrs& fitnesses,
-                                  const Random& random)
+                                  const Random& random,
+                                  size_t thread_count,
+                                  Sampler sampler)
 {
     if (config.size == 0)
         return;
@@ -262,40 +396,65 @@ void Population::create_organisms(const Config& config,
     if (populations.size() != fitnesses.size())
         throw runtime_error("[Population::create_organisms()] Fitness vector count != population count.");
 
-    organisms_.reserve(config.size);
-
     // instantiate RandomOrganismIndexGenerators (one for each population)
 
-    vector<RandomOrganismIndexGeneratorPtr> random_organism_index_generators;
+    RandomOrganismIndexGeneratorPtrs random_organism_index_generators;
 
     DataVectorPtrs::const_iterator fitness = fitnesses.begin();
     for (PopulationPtrs::const_iterator population=populations.begin(); population!=populations.end(); ++population, ++fitness)
         random_organism_index_generators.push_back(RandomOrganismIndexGeneratorPtr(
-            new RandomOrganismIndexGenerator(**population, *fitness, random)));
+            new RandomOrganismIndexGenerator(**population, *fitness, sampler)));
 
-    // create Organisms for new population
+    // create Organisms for new population: a single draw from random keys the
+    // per-offspring streams, so serial and parallel runs give identical results
 
-    for (size_t i=0; i<config.size; ++i)
-    {
-        const MatingDistribution::IndexPair& parentIndices = config.matingDistribution.random_index_pair(random);
+    const unsigned int stream_seed = random_seed(random);
+
+    // offspring overwrite recycled organisms (see recycle()) when there are any,
+    // and empty organisms (no chromosomes, nothing allocated) otherwise
 
-        if (max(parentIndices.first,parentIndices.second) >= populations.size())
-            throw runtime_error("[Population::Population()] Indices out of bounds.");
+    const size_t offset = organisms_.size();
+    const size_t reused = min(spare_.size(), config.size);
 
-        if (populations[parentIndices.first]->organisms().empty() ||
-            populations[parentIndices.second]->organisms().empty())
-            throw runtime_error("[Population::Population()] Empty population.");
+    organisms_.reserve(offset + config.size);
+    organisms_.insert(organisms_.end(), make_move_iterator(spare_.end() - reused), make_move_iterator(spare_.end()));
+    spare_.erase(spare_.end() - reused, spare_.end());
+    organisms_.resize(offset + config.size, Organism(Organism::Gamete(), Organism::Gamete()));
 
-        size_t index1 = (*random_organism_index_generators[parentIndices.first])();
-        size_t index2 = 0;
-        do { // avoid selfing
-            index2 = (*random_organism_index_generators[parentIndices.second])();
-        } while (parentIndices.first == parentIndices.second && index1 == index2);
+    // on failure, drop the partially created offspring
+
+    try
+    {
+        thread_count = max(min(thread_count, config.size), size_t(1));
+
+        if (arenas_.size() < thread_count) arenas_.resize(thread_count);
+        for (vector< shared_ptr<BlockArena> >::iterator it=arenas_.begin(); it!=arenas_.end(); ++it)
+        {
+            if (!it->get()) it->reset(new BlockArena(1<<16, true));
+            (*it)->recycle();
+        }
 
-        const Organism& mom = populations[parentIndices.first]->organisms()[index1];
-        const Organism& dad = populations[parentIndices.second]->organisms()[index2];
-        organisms_.push_back(Organism(mom, dad));
+        OffspringCreator creator(config, populations, random_organism_index_generators, stream_seed, sampler,
+                                 organisms_.data() + offset, arenas_);
+        parallel_for(config.size, thread_count, creator);
     }
+    catch (...)
+    {
+        organisms_.erase(organisms_.begin() + offset, organisms_.end());
+        throw;
+    }
+}
+
+
+void Population::recycle()
+{
+    spare_.swap(organisms_);
+    organisms_.clear();
+
+    // release the blocks now, so that their arena chunks can be reused
+
+    for (Organisms::iterator it=spare_.begin(); it!=spare_.end(); ++it)
+        it->clear();
 }
 
 
@@ -309,6 +468,7 @@ shared_ptr<Population> Population::randomSubsample(size_t size, Random& random)
         indices.insert(random.randint(0,organisms_.size()-1));
 
     shared_ptr<Population> subsample(new Population());
+    subsample->organisms_.reserve(size);
 
     for (set<size_t>::const_iterator it=indices.begin(); it!=indices.end(); ++it)
         subsample->organisms_.push_back(organisms_[*it]);
@@ -340,18 +500,38 @@ void Population::write(ostream& os) const
 PopulationPtrsPtr Population::create_populations(const vector<Population::Config>& configs,
                                                  const PopulationPtrs& previous, 
                                                  const DataVectorPtrs& fitnesses,
-                                                 const Random& random)
+                                                 const Random& random,
+                                                 size_t thread_count,
+                                                 Sampler sampler)
 {
     PopulationPtrsPtr result(new PopulationPtrs);
+    create_populations(*result, configs, previous, fitnesses, random, thread_count, sampler);
+    return result;
+}
 
-    for (vector<Population::Config>::const_iterator it=configs.begin(); it!=configs.end(); ++it)
+
+void Population::create_populations(PopulationPtrs& result,
+                                    const vector<Population::Config>& configs,
+                                    const PopulationPtrs& previous,
+                                    const DataVectorPtrs& fitnesses,
+                                    const Random& random,
+                                    size_t thread_count,
+                                    Sampler sampler)
+{
+    result.resize(configs.size());
+
+    PopulationPtrs::iterator p = result.begin();
+    for (vector<Population::Config>::const_iterator it=configs.begin(); it!=configs.end(); ++it, ++p)
     {
-        PopulationPtr p(new Population);
-        p->create_organisms(*it, previous, fitnesses, random);
-        result->push_back(p);
-    }        
+        // a Population held elsewhere (e.g. in previous, or by a reporter) is left alone
 
-    return result;
+        if (p->get() && p->use_count() == 1)
+            (*p)->recycle();
+        else
+            p->reset(new Population);
+
+        (*p)->create_organisms(*it, previous, fitnesses, random, thread_count, sampler);
+    }
 }
 
 
@@ -470,7 +650,11 @@ ostream& operator<<(ostream& os, const Population& p)
 istream& operator>>(istream& is, Population& p)
 {
     p.organisms_.clear();
-    copy(istream_iterator<Organism>(is), istream_iterator<Organism>(), back_inserter(p.organisms_));
+
+    Organism organism;
+    while (is >> organism)
+        p.organisms_.push_back(std::move(organism));
+
     return is;
 }
 
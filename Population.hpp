@@ -20,12 +20,29 @@
 #define _POPULATION_HPP_
 
 
+#include "AliasTable.hpp"
 #include "DataVector.hpp"
 #include "Organism.hpp"
+#include "BlockArena.hpp"
 #include "shared_ptr.hpp"
 #include <vector>
 
 
+//
+// Sampler: backend for weighted random choices (mating pairs, fitness-weighted parents)
+//
+// Both draw from the same distribution, but turn Random values into choices
+// differently, so the two give different runs for the same seed.  The default is
+// Sampler_BinarySearch.  Weights that are all zero fall back to binary search
+// (first entry always chosen).
+//
+enum Sampler
+{
+    Sampler_BinarySearch,   // lower_bound in cumulative weights: O(log n) per draw
+    Sampler_AliasTable      // Walker/Vose alias table, built on first use: O(1) per draw
+};
+
+
 class MatingDistribution
 {
     public:
@@ -34,7 +51,7 @@ class MatingDistribution
 
     MatingDistribution() : totalWeight_(0) {}
     void push_back(double weight, const IndexPair& indexPair);
-    const IndexPair& random_index_pair(const Random& random) const;
+    const IndexPair& random_index_pair(const Random& random, Sampler sampler = Sampler_BinarySearch) const;
 
     struct Entry
     {
@@ -50,6 +67,9 @@ class MatingDistribution
     private:
     Entries entries_;
     double totalWeight_;
+    mutable shared_ptr<const AliasTable> aliasTable_; // built by the first alias-table draw, reset by push_back()
+
+    shared_ptr<const AliasTable> alias_table() const;
 };
 
 
@@ -97,10 +117,16 @@ class Population
 
     typedef std::vector<Config> Configs;
 
+    // offspring are created with per-offspring Random streams keyed by a draw from random,
+    // so the result is the same for any thread_count; thread_count > 1 requires a
+    // RecombinationPositionGenerator that uses the Random it is given;
+    // sampler selects how parents are drawn from the mating distribution and fitnesses
     void create_organisms(const Config& config,
                           const PopulationPtrs& populations = PopulationPtrs(),
                           const DataVectorPtrs& fitnesses = DataVectorPtrs(), // null ok, but size must match populations
-                          const Random& random = Random());
+                          const Random& random = Random(),
+                          size_t thread_count = 1,
+                          Sampler sampler = Sampler_BinarySearch);
 
     const std::vector<Organism>& organisms() const {return organisms_;}
     size_t size() const {return organisms_.size();}
@@ -117,11 +143,28 @@ class Population
     static PopulationPtrsPtr create_populations(const std::vector<Population::Config>& configs,
                                                 const PopulationPtrs& previous, 
                                                 const DataVectorPtrs& fitnesses,
-                                                const Random& random);
+                                                const Random& random,
+                                                size_t thread_count = 1,
+                                                Sampler sampler = Sampler_BinarySearch);
+
+    // same, reusing the Populations in result (e.g. generation g-2) that nothing else
+    // holds, so that organism storage is recycled instead of reallocated
+    static void create_populations(PopulationPtrs& result,
+                                   const std::vector<Population::Config>& configs,
+                                   const PopulationPtrs& previous,
+                                   const DataVectorPtrs& fitnesses,
+                                   const Random& random,
+                                   size_t thread_count = 1,
+                                   Sampler sampler = Sampler_BinarySearch);
+
+    // drop the organisms, keeping their storage for the next create_organisms()
+    void recycle();
 
     private:
 
     Organisms organisms_;
+    Organisms spare_; // recycled organisms, overwritten in place by create_organisms()
+    std::vector< shared_ptr<BlockArena> > arenas_; // one per offspring range, reused with the Population
 
     friend std::istream& operator>>(std::istream& is, Population& p);
 
@@ -21,6 +21,8 @@
 #include <iostream>
 #include <iterator>
 #include <cstring>
+#include <thread>
+#include <atomic>
 
 
 using namespace std;
@@ -46,18 +48,26 @@ void testMatingDistribution()
     unit_assert(md.entries()[2].indexPair.first == 2);
     unit_assert(md.entries()[2].indexPair.second == 0);
 
-    vector<int> counts(3);
-
     Random random;
 
-    for (int i=0; i<9000; i++)
+    const Sampler samplers[] = {Sampler_BinarySearch, Sampler_AliasTable};
+    for (size_t s=0; s<2; ++s)
     {
-        const MatingDistribution::IndexPair& p = md.random_index_pair(random);
-        counts[p.first]++;
-    }
+        vector<int> counts(3);
+
+        for (int i=0; i<9000; i++)
+        {
+            const MatingDistribution::IndexPair& p = md.random_index_pair(random, samplers[s]);
+            counts[p.first]++;
+        }
+
+        for (size_t i=0; i<3; i++)
+            if (os_) *os_ << "count " << i << ": " << counts[i] << endl;
 
-    for (size_t i=0; i<3; i++)
-        if (os_) *os_ << "count " << i << ": " << counts[i] << endl;
+        unit_assert_equal(counts[0]/9000., 6/9., .02);
+        unit_assert_equal(counts[1]/9000., 2/9., .02);
+        unit_assert_equal(counts[2]/9000., 1/9., .02);
+    }
 
 
     // test I/O
@@ -75,6 +85,110 @@ void testMatingDistribution()
 }
 
 
+void testAliasTableLazy()
+{
+    if (os_) *os_ << "testAliasTableLazy()\n";
+
+    // the alias table is built on the first draw and dropped by push_back()
+
+    MatingDistribution md;
+    md.push_back(1, make_pair(0,0));
+
+    Random random(5);
+    unit_assert(md.random_index_pair(random, Sampler_AliasTable) == make_pair(size_t(0),size_t(0)));
+
+    md.push_back(0, make_pair(1,1));
+    md.push_back(1e6, make_pair(2,2));
+
+    size_t count = 0;
+    for (int i=0; i<100; i++)
+        if (md.random_index_pair(random, Sampler_AliasTable) == make_pair(size_t(2),size_t(2))) ++count;
+    unit_assert(count > 90);
+
+    // first draws from several threads at once
+
+    MatingDistribution md2;
+    for (size_t i=0; i<100; i++)
+        md2.push_back(i%2, make_pair(i,i));
+
+    atomic<size_t> odd(0);
+    vector<thread> threads;
+    for (unsigned int t=0; t<8; t++)
+        threads.push_back(thread([&md2, &odd, t]()
+        {
+            Random r(t);
+            for (int i=0; i<1000; i++)
+                if (md2.random_index_pair(r, Sampler_AliasTable).first % 2) ++odd;
+        }));
+    for (size_t t=0; t<threads.size(); t++)
+        threads[t].join();
+    unit_assert(odd == 8000);
+}
+
+
+void testZeroWeights()
+{
+    if (os_) *os_ << "testZeroWeights()\n";
+
+    // zero total weight: both samplers fall back to binary search, which picks
+    // the first entry, as before alias tables
+
+    MatingDistribution md;
+    md.push_back(0, make_pair(0,1));
+    md.push_back(0, make_pair(1,0));
+
+    Random random;
+    for (int i=0; i<10; i++)
+    {
+        unit_assert(md.random_index_pair(random, Sampler_BinarySearch) == make_pair(size_t(0),size_t(1)));
+        unit_assert(md.random_index_pair(random, Sampler_AliasTable) == make_pair(size_t(0),size_t(1)));
+    }
+
+    // all-zero fitnesses: the first organism of each population is always chosen
+
+    vector<string> filenames(1, "genetic_map_chr21_b36.txt");
+    Random random_map;
+
+    Organism::recombinationPositionGenerator_ =
+        shared_ptr<RecombinationPositionGenerator>(
+            new RecombinationPositionGenerator_RecombinationMap(filenames, random_map));
+
+    PopulationPtrs populations;
+    DataVectorPtrs fitnesses;
+    for (unsigned int id=0; id<2; ++id)
+    {
+        Population::Config config;
+        config.size = 10;
+        config.chromosomePairCount = 1;
+        config.populationID = id;
+        populations.push_back(PopulationPtr(new Population));
+        populations.back()->create_organisms(config);
+        fitnesses.push_back(DataVectorPtr(new DataVector(10, 0.)));
+    }
+
+    Population::Config config;
+    config.size = 20;
+    config.matingDistribution.push_back(1, make_pair(0,1));
+
+    const Sampler samplers[] = {Sampler_BinarySearch, Sampler_AliasTable};
+    for (size_t s=0; s<2; ++s)
+    {
+        Population p;
+        p.create_organisms(config, populations, fitnesses, random, 1, samplers[s]);
+        unit_assert(p.size() == config.size);
+
+        for (Organisms::const_iterator it=p.organisms().begin(); it!=p.organisms().end(); ++it)
+        {
+            const Chromosome& c = it->chromosomePairs()[0].first;
+            for (DNABlockSpan::const_iterator block=c.blocks().begin(); block!=c.blocks().end(); ++block)
+                unit_assert(Chromosome::ID(block->id).individual == 0);
+        }
+    }
+
+    Organism::recombinationPositionGenerator_ = shared_ptr<RecombinationPositionGenerator>();
+}
+
+
 void testPopulationConfigIO()
 {
     if (os_) *os_ << "testPopulationConfigIO()\n";
@@ -403,6 +517,162 @@ void testPopulation_fitness_constructor_2()
 }
 
 
+void testPopulation_parallel()
+{
+    if (os_) *os_ << "testPopulation_parallel()\n";
+
+    vector<string> filenames(3, "genetic_map_chr21_b36.txt");
+    Random random_map;
+
+    Organism::recombinationPositionGenerator_ =
+        shared_ptr<RecombinationPositionGenerator>(
+            new RecombinationPositionGenerator_RecombinationMap(filenames, random_map));
+
+    Population::Config config0;
+    config0.size = 100;
+    config0.chromosomePairCount = 3;
+
+    PopulationPtr p0(new Population());
+    p0->create_organisms(config0);
+
+    PopulationPtrs populations;
+    populations.push_back(p0);
+
+    Population::Config config1;
+    config1.size = 1000;
+    config1.matingDistribution.push_back(1, make_pair(0,0));
+
+    const unsigned int seed = 123;
+
+    Random random(seed);
+    Population p1;
+    p1.create_organisms(config1, populations, DataVectorPtrs(1), random, 4);
+    unit_assert(p1.size() == config1.size);
+
+    // same seed: identical populations, regardless of thread count
+
+    const size_t thread_counts[] = {1, 4, 7};
+
+    for (size_t i=0; i<3; ++i)
+    {
+        random.seed(seed);
+        Population p1b;
+        p1b.create_organisms(config1, populations, DataVectorPtrs(1), random, thread_counts[i]);
+        unit_assert(p1 == p1b);
+    }
+
+    // different seed: different population
+
+    random.seed(seed + 1);
+    Population p1c;
+    p1c.create_organisms(config1, populations, DataVectorPtrs(1), random, 4);
+    unit_assert(p1 != p1c);
+
+    // all blocks inherited from generation 0
+
+    for (Organisms::const_iterator it=p1.organisms().begin(); it!=p1.organisms().end(); ++it)
+    {
+        unit_assert(it->chromosomePairs().size() == 3);
+        for (size_t i=0; i<3; ++i)
+        {
+            const Chromosome& c = it->chromosomePairs()[i].first;
+            for (DNABlockSpan::const_iterator block=c.blocks().begin(); block!=c.blocks().end(); ++block)
+            {
+                Chromosome::ID id(block->id);
+                unit_assert(id.individual < config0.size && id.pair == i);
+            }
+        }
+    }
+
+    if (os_) *os_ << "p1[0]:\n" << p1.organisms()[0] << endl;
+
+    Organism::recombinationPositionGenerator_ = shared_ptr<RecombinationPositionGenerator>();
+}
+
+
+void testPopulation_recycle()
+{
+    if (os_) *os_ << "testPopulation_recycle()\n";
+
+    vector<string> filenames(2, "genetic_map_chr21_b36.txt");
+    Random random_map;
+
+    Organism::recombinationPositionGenerator_ =
+        shared_ptr<RecombinationPositionGenerator>(
+            new RecombinationPositionGenerator_RecombinationMap(filenames, random_map));
+
+    Population::Config config0;
+    config0.size = 20;
+    config0.chromosomePairCount = 2;
+
+    PopulationPtr p0(new Population());
+    p0->create_organisms(config0);
+
+    PopulationPtrs generation0;
+    generation0.push_back(p0);
+
+    Population::Configs configs(1);
+    configs[0].size = 30;
+    configs[0].matingDistribution.push_back(1, make_pair(0,0));
+
+    Random random(123);
+    PopulationPtrsPtr generation1 = Population::create_populations(configs, generation0, DataVectorPtrs(1), random);
+    PopulationPtrsPtr generation2 = Population::create_populations(configs, *generation1, DataVectorPtrs(1), random);
+    PopulationPtrsPtr generation3 = Population::create_populations(configs, *generation2, DataVectorPtrs(1), random);
+
+    // double buffer: generation 3 goes in the buffer of generation 1, in the same
+    // Population object, with the same result
+
+    random.seed(123);
+    PopulationPtrs buffer_a, buffer_b;
+    Population::create_populations(buffer_a, configs, generation0, DataVectorPtrs(1), random);
+    Population::create_populations(buffer_b, configs, buffer_a, DataVectorPtrs(1), random);
+    unit_assert(*buffer_b[0] == *generation2->front());
+
+    Population* recycled = buffer_a[0].get();
+    Population::create_populations(buffer_a, configs, buffer_b, DataVectorPtrs(1), random);
+    unit_assert(buffer_a[0].get() == recycled);
+    unit_assert(*buffer_a[0] == *generation3->front());
+
+    // a Population held elsewhere is not recycled
+
+    PopulationPtr held = buffer_a[0];
+    Population::create_populations(buffer_a, configs, buffer_b, DataVectorPtrs(1), random);
+    unit_assert(buffer_a[0] != held);
+    unit_assert(*held == *generation3->front());
+
+    // a failed generation leaves nothing behind: parents with different chromosome
+    // pair counts make the first offspring throw
+
+    Population::Config config1;
+    config1.size = 10;
+    config1.chromosomePairCount = 1;
+
+    PopulationPtr p1(new Population());
+    p1->create_organisms(config1);
+
+    PopulationPtrs mismatched;
+    mismatched.push_back(p0);
+    mismatched.push_back(p1);
+
+    Population::Config bad;
+    bad.size = 50; // more than the recycled organisms
+    bad.matingDistribution.push_back(1, make_pair(0,1));
+
+    Population& target = *buffer_b[0];
+    target.recycle();
+    unit_assert_throws(target.create_organisms(bad, mismatched, DataVectorPtrs(2), random), runtime_error);
+    unit_assert(target.size() == 0);
+
+    target.create_organisms(configs[0], generation0, DataVectorPtrs(1), random);
+    unit_assert(target.size() == 30);
+    for (size_t i=0; i<target.size(); ++i)
+        unit_assert(target.organisms()[i].chromosomePairs().size() == 2);
+
+    Organism::recombinationPositionGenerator_ = shared_ptr<RecombinationPositionGenerator>();
+}
+
+
 void test_generation_IO()
 {
     vector<Population::Configs> populationConfigs;
@@ -467,6 +737,8 @@ void test_generation_IO()
 void test()
 {
     testMatingDistribution();
+    testZeroWeights();
+    testAliasTableLazy();
     testPopulation_initial();
     testPopulation_generated();
     testPopulationConfigIO();
@@ -474,6 +746,8 @@ void test()
     testPopulationIO_Binary();
     testPopulation_fitness_constructor();
     testPopulation_fitness_constructor_2();
+    testPopulation_parallel();
+    testPopulation_recycle();
     test_generation_IO();
 }
 
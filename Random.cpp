@@ -17,63 +17,255 @@
 //
 
 #include "Random.hpp"
-#include "boost/random.hpp"
+#include <stdexcept>
+#include <cmath>
+#include <stdint.h>
 
 
 using namespace std;
 
 
+namespace {
+
+// SplitMix64 finalizer: bijective 64-bit mixing function
+inline uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+const uint64_t golden_gamma_ = 0x9e3779b97f4a7c15ULL;
+
+
+// 53 random bits -> double in [0,1)
+inline double to_01(uint64_t x)
+{
+    return (x >> 11) * (1.0/9007199254740992.0);
+}
+
+
+// high 64 bits of the 128-bit product x*y
+inline uint64_t mul_high64(uint64_t x, uint64_t y)
+{
+#ifdef __SIZEOF_INT128__
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(x) * y) >> 64);
+#else
+    // portable: schoolbook multiply on 32-bit halves
+    const uint64_t x_lo = x & 0xffffffff, x_hi = x >> 32;
+    const uint64_t y_lo = y & 0xffffffff, y_hi = y >> 32;
+    const uint64_t lo_lo = x_lo * y_lo;
+    const uint64_t hi_lo = x_hi * y_lo;
+    const uint64_t lo_hi = x_lo * y_hi;
+    const uint64_t hi_hi = x_hi * y_hi;
+    const uint64_t middle = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+    return hi_hi + (hi_lo >> 32) + (middle >> 32);
+#endif
+}
+
+
+// uniform integer in [0, range), by multiply-shift (no division, no double)
+inline uint64_t to_range(uint64_t x, uint64_t range)
+{
+    return mul_high64(x, range);
+}
+
+
+// log(k!), without lgamma(), which writes the global signgam and so races when
+// offspring are created in parallel: table for small k, Stirling series above
+double log_factorial(double k)
+{
+    const size_t table_size = 128;
+
+    struct Table
+    {
+        double values[table_size];
+        Table()
+        {
+            values[0] = 0;
+            for (size_t i=1; i<table_size; ++i)
+                values[i] = values[i-1] + log(double(i));
+        }
+    };
+
+    static const Table table;
+
+    if (k < table_size) return table.values[static_cast<size_t>(k)];
+
+    const double k2 = k * k;
+    return k * log(k) - k + 0.5 * log(2 * M_PI * k) +
+           (1./12 - (1./360 - 1./(1260 * k2)) / k2) / k;
+}
+
+
+// transforms from raw 64-bit values
+
+struct Uniform
+{
+    typedef double result_type;
+    double a, scale;
+    Uniform(double _a, double b) : a(_a), scale(b-_a) {}
+    double operator()(uint64_t x) const {return to_01(x) * scale + a;}
+};
+
+
+struct RandInt
+{
+    typedef int result_type;
+    int a;
+    uint64_t range;
+    RandInt(int _a, int b) : a(_a), range(uint64_t(int64_t(b) - _a + 1)) {}
+    int operator()(uint64_t x) const {return int(a + int64_t(to_range(x, range)));}
+};
+
+} // namespace
+
+
+//
+// counter-based stream: value n = mix64(key + n*gamma), i.e. SplitMix64 started
+// at a point determined by hashing the stream key
+//
 struct Random::Impl
 {
-    boost::mt19937 rng; // generator
-    boost::uniform_real<> dist_01; // distribution ~ Uniform(0,1)
-    boost::variate_generator<boost::mt19937&, boost::uniform_real<> >
-        random_01; // glues generator to distribution 
+    uint64_t key;
+    uint64_t counter;
 
-    Impl(unsigned int seed)
-    :   dist_01(0,1), random_01(rng, dist_01)
+    Impl(unsigned int seed, unsigned int key1, unsigned int key2, unsigned int key3)
     {
-        rng.seed(seed);
+        reset(seed, key1, key2, key3);
+    }
+
+    void reset(unsigned int seed, unsigned int key1, unsigned int key2, unsigned int key3)
+    {
+        key = mix64(seed + golden_gamma_);
+        key = mix64(key ^ (key1 + golden_gamma_));
+        key = mix64(key ^ (key2 + golden_gamma_));
+        key = mix64(key ^ (key3 + golden_gamma_));
+        counter = 0;
+    }
+
+    uint64_t next()
+    {
+        return mix64(key + (++counter) * golden_gamma_);
+    }
+
+    double next_01()
+    {
+        return to_01(next());
+    }
+
+    // bulk: values don't depend on each other, so iterations overlap in the
+    // pipeline (the 64-bit multiplies keep the loop scalar on AVX2)
+
+    template <typename Transform>
+    void fill(Transform transform, typename Transform::result_type* begin,
+              typename Transform::result_type* end)
+    {
+        const uint64_t k = key;
+        const uint64_t c = counter + 1;
+        const size_t n = end - begin;
+        for (size_t i=0; i<n; ++i)
+            begin[i] = transform(mix64(k + (c+i) * golden_gamma_));
+        counter += n;
     }
 };
 
 
 Random::Random(unsigned int seed)
-:   impl_(new Impl(seed))
+:   impl_(new Impl(seed, 0, 0, 0))
+{}
+
+
+Random::Random(unsigned int seed, unsigned int key1, unsigned int key2, unsigned int key3)
+:   impl_(new Impl(seed, key1, key2, key3))
 {}
 
 
 void Random::seed(unsigned int value)
 {
-    impl_->rng.seed(value);
+    impl_->reset(value, 0, 0, 0);
+}
+
+
+void Random::seed(unsigned int value, unsigned int key1, unsigned int key2, unsigned int key3)
+{
+    impl_->reset(value, key1, key2, key3);
 }
 
 
 int Random::randint(int a, int b) const
 {
-/*   
-    // not sure if instantiation of these objects takes longer than doing this ourselves
-    boost::uniform_int<> dist(a,b); // distribution
-    boost::variate_generator<boost::mt19937&, boost::uniform_int<> >
-        vg(impl_->rng, dist); // glues generator to distribution 
-    return vg();
-*/
-    double t = impl_->random_01();
-    int result = a + int(t*(b+1-a));
-    if (result == b+1) throw runtime_error("[Random::randint()] This isn't happening.");
-    return result;
+    if (b < a) throw runtime_error("[Random::randint()] Empty range.");
+    return RandInt(a, b)(impl_->next());
 }
 
 
 double Random::random() const
 {
-    return impl_->random_01();
+    return impl_->next_01();
 }
 
 
 double Random::uniform(double a, double b) const
 {
-    return impl_->random_01() * (b-a) + a;
+    return impl_->next_01() * (b-a) + a;
+}
+
+
+unsigned int Random::poisson(double mean) const
+{
+    if (!(mean >= 0)) throw runtime_error("[Random::poisson()] Invalid mean.");
+
+    if (mean < 10)
+    {
+        // inversion: walk the cdf from 0 until it exceeds a single uniform roll
+
+        const double roll = impl_->next_01();
+        double p = exp(-mean);
+        double cdf = p;
+        unsigned int k = 0;
+
+        while (roll > cdf && p > 0)
+        {
+            ++k;
+            p *= mean / k;
+            cdf += p;
+        }
+
+        return k;
+    }
+
+    // PTRS: transformed rejection with squeeze (Hormann 1993)
+
+    const double slam = sqrt(mean);
+    const double loglam = log(mean);
+    const double b = 0.931 + 2.53 * slam;
+    const double a = -0.059 + 0.02483 * b;
+    const double invalpha = 1.1239 + 1.1328 / (b - 3.4);
+    const double vr = 0.9277 - 3.6224 / (b - 2);
+
+    while (true)
+    {
+        const double u = impl_->next_01() - 0.5;
+        const double v = impl_->next_01();
+        const double us = 0.5 - fabs(u);
+        const double k = floor((2 * a / us + b) * u + mean + 0.43);
+
+        if (us >= 0.07 && v <= vr)
+            return static_cast<unsigned int>(k);
+
+        if (k < 0 || (us < 0.013 && v > us))
+            continue;
+
+        if (log(v) + log(invalpha) - log(a / (us * us) + b) <= -mean + k * loglam - log_factorial(k))
+            return static_cast<unsigned int>(k);
+    }
+}
+
+
+void Random::random(double* begin, double* end) const
+{
+    impl_->fill(Uniform(0, 1), begin, end);
 }
 
 
@@ -24,18 +24,32 @@
 
 
 //
-// simple random number generator, using Boost.Random;
+// simple random number generator;
 // method names match Python random module
 //
+// The generator is counter-based: the n-th value of a stream is a hash of
+// (stream key, n).  A stream is keyed by a seed and optionally up to three
+// more values, e.g. (seed, generation, population, offspring index), so
+// independent streams can be created cheaply in any order, on any thread,
+// and give the same values regardless of execution order.
+//
 class Random
 {
     public:
-    
+
     Random(unsigned int seed = 0);
 
-    // set seed
+    // independent stream keyed by (seed, key1, key2, key3)
+    Random(unsigned int seed, unsigned int key1, unsigned int key2 = 0, unsigned int key3 = 0);
+
+    // set seed (restarts the stream)
     void seed(unsigned int value);
 
+    // switch to the stream keyed by (value, key1, key2, key3), as if constructed
+    // with those keys but without allocating (e.g. one Random per thread, rekeyed
+    // for each offspring)
+    void seed(unsigned int value, unsigned int key1, unsigned int key2 = 0, unsigned int key3 = 0);
+
     // return random integer N with a <= N <= b
     int randint(int a, int b) const;
 
@@ -45,6 +59,14 @@ class Random
     // return random double in [a,b)
     double uniform(double a, double b) const;
 
+    // return random Poisson-distributed integer with the given mean (no allocation;
+    // inversion for small means, transformed rejection (PTRS) for large means)
+    unsigned int poisson(double mean) const;
+
+    // bulk version: fill [begin, end) with the same values that the
+    // equivalent sequence of single calls would return
+    void random(double* begin, double* end) const;
+
     private:
     class Impl;
     shared_ptr<Impl> impl_;
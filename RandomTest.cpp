@@ -23,6 +23,8 @@
 #include <vector>
 #include <cstring>
 #include <ctime>
+#include <limits>
+#include <cmath>
 
 
 using namespace std;
@@ -84,6 +86,135 @@ void test_seed()
 }
 
 
+void test_streams()
+{
+    if (os_) *os_ << "test_streams()\n";
+
+    const unsigned int seed = 420;
+    const size_t stream_count = 100;
+    const size_t n = 100;
+
+    // fill streams in forward order, one value at a time from each
+
+    vector< vector<double> > values(stream_count);
+    {
+        vector< shared_ptr<Random> > streams;
+        for (size_t i=0; i<stream_count; ++i)
+            streams.push_back(shared_ptr<Random>(new Random(seed, 7, i)));
+
+        for (size_t j=0; j<n; ++j)
+        for (size_t i=0; i<stream_count; ++i)
+            values[i].push_back(streams[i]->random());
+    }
+
+    // streams created in reverse order and drawn one at a time must match
+
+    for (size_t i=stream_count; i-->0; )
+    {
+        Random stream(seed, 7, i);
+        for (size_t j=0; j<n; ++j)
+            unit_assert(stream.random() == values[i][j]);
+    }
+
+    // one Random rekeyed with seed(value, keys...) gives the same streams
+
+    Random rekeyed;
+    for (size_t i=0; i<stream_count; ++i)
+    {
+        rekeyed.seed(seed, 7, i);
+        for (size_t j=0; j<n; ++j)
+            unit_assert(rekeyed.random() == values[i][j]);
+    }
+
+    // streams with different keys differ; overall mean ~ .5
+
+    double sum = 0;
+    for (size_t i=0; i<stream_count; ++i)
+    {
+        if (i>0) unit_assert(values[i] != values[i-1]);
+        for (size_t j=0; j<n; ++j)
+        {
+            unit_assert(values[i][j] >= 0 && values[i][j] < 1);
+            sum += values[i][j];
+        }
+    }
+
+    double mean = sum / (stream_count * n);
+    if (os_) *os_ << "mean: " << mean << endl << endl;
+    unit_assert_equal(mean, .5, .01);
+
+    // different seed, same keys
+    
+    Random a(seed, 7, 0);
+    Random b(seed+1, 7, 0);
+    unit_assert(a.random() != b.random());
+}
+
+
+void test_bulk()
+{
+    if (os_) *os_ << "test_bulk()\n";
+
+    const size_t n = 1000;
+    Random a(42, 1);
+    Random b(42, 1);
+
+    // bulk draws match the equivalent single draws, and continue the same stream
+
+    vector<double> randoms(n);
+    a.random(&randoms[0], &randoms[0]+n);
+    for (size_t i=0; i<n; ++i)
+        unit_assert(randoms[i] == b.random());
+
+    unit_assert(a.randint(0, 1000000) == b.randint(0, 1000000));
+
+    // full int range
+
+    for (size_t i=0; i<100; ++i)
+        a.randint(numeric_limits<int>::min(), numeric_limits<int>::max());
+
+    unit_assert_throws(a.randint(1, 0), runtime_error);
+
+    if (os_) *os_ << endl;
+}
+
+
+void test_poisson()
+{
+    if (os_) *os_ << "test_poisson()\n";
+
+    Random random(42);
+
+    // sample mean and variance both estimate the Poisson mean, across the
+    // inversion (mean < 10) and rejection (mean >= 10) samplers
+
+    const double means[] = {0, .3, 2.5, 9.9, 10, 42, 1000, 1e6};
+    const size_t n = 100000;
+
+    for (size_t i=0; i<sizeof(means)/sizeof(double); ++i)
+    {
+        double sum = 0, sum2 = 0;
+        for (size_t j=0; j<n; ++j)
+        {
+            double k = random.poisson(means[i]);
+            sum += k;
+            sum2 += k*k;
+        }
+
+        double mean = sum/n;
+        double variance = sum2/n - mean*mean;
+
+        if (os_) *os_ << means[i] << ": mean " << mean << " variance " << variance << endl;
+
+        const double sd_mean = sqrt(means[i]/n); // standard error of the sample mean
+        unit_assert_equal(mean, means[i], 5*sd_mean + 1e-12);
+        unit_assert_equal(variance, means[i], .03*means[i] + 1e-12);
+    }
+
+    unit_assert_throws(random.poisson(-1), runtime_error);
+}
+
+
 int main(int argc, char* argv[])
 {
     try
@@ -91,6 +222,9 @@ int main(int argc, char* argv[])
         if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
         test();
         test_seed();
+        test_streams();
+        test_bulk();
+        test_poisson();
         return 0;
     }
     catch(exception& e)
@@ -23,103 +23,295 @@
 #include <iterator>
 #include <stdexcept>
 #include <cmath>
+#include <algorithm>
+#include <limits>
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
 
 
 using namespace std;
+namespace bip = boost::interprocess;
 
 
 namespace {
 
-unsigned int factorial(unsigned int n)
+const char binary_magic_[8] = {'S', 'R', 'G', 'M', 'A', 'P', '0', '1'};
+
+struct BinaryHeader
 {
-    unsigned int result = 1; 
-    for (; n>1; n--) result *= n;
-    return result;
-}
+    char magic[8];
+    uint64_t count;
+    double geneticMapMax;
+    uint64_t reserved;
+};
+
+struct MapStorage
+{
+    shared_ptr<bip::mapped_region> region;
+    vector<unsigned int> positions;
+    vector<RecombinationMap::GeneticMapValue> geneticMap;
+};
 
 } // namespace
 
 
 RecombinationMap::RecombinationMap(const string& filename, const Random& random)
-:   random_(random)
+:   random_(random), geneticMapMax_(0), geneticMapScale_(1), bucketWidth_(0)
 {
-    // read in data file
-    ifstream is(filename.c_str());
-    string header;
-    getline(is, header);
-    copy(istream_iterator<RecombinationMap::Record>(is), 
-         istream_iterator<RecombinationMap::Record>(), 
-         back_inserter(records_));
-    if (records_.empty())
+    shared_ptr<MapStorage> storage(new MapStorage);
+    storage_ = storage;
+
+    const double* geneticMap_cM = 0;
+    vector<double> geneticMap_text;
+
+    if (is_binary(filename))
+    {
+        // map the file; positions are used in place
+
+        bip::file_mapping file(filename.c_str(), bip::read_only);
+        storage->region.reset(new bip::mapped_region(file, bip::read_only));
+
+        const char* data = static_cast<const char*>(storage->region->get_address());
+        const size_t data_size = storage->region->get_size();
+        const BinaryHeader* header = reinterpret_cast<const BinaryHeader*>(data);
+
+        // compare by division, so that a corrupt count can't overflow the size check
+
+        const size_t record_size = sizeof(double) + sizeof(uint32_t);
+        if (data_size < sizeof(BinaryHeader) ||
+            (data_size - sizeof(BinaryHeader)) % record_size != 0 ||
+            header->count != (data_size - sizeof(BinaryHeader)) / record_size)
+            throw runtime_error(("[RecombinationMap] Bad binary map file " + filename).c_str());
+
+        geneticMap_cM = reinterpret_cast<const double*>(data + sizeof(BinaryHeader));
+        positions_ = Span<unsigned int>(reinterpret_cast<const unsigned int*>(geneticMap_cM + header->count),
+                                        header->count);
+    }
+    else
+    {
+        // read in data file, keeping only the columns we use
+
+        ifstream is(filename.c_str());
+        string header;
+        getline(is, header);
+
+        Record record;
+        while (is >> record)
+        {
+            storage->positions.push_back(record.position);
+            geneticMap_text.push_back(record.geneticMap);
+        }
+
+        positions_ = Span<unsigned int>(storage->positions.data(), storage->positions.size());
+        geneticMap_cM = geneticMap_text.data();
+    }
+
+    if (positions_.empty())
         throw runtime_error(("[RecombinationMap] Error reading file " + filename).c_str());
 
-    // calculate Poisson distribution for number of recombination events
-    // rate == cumulative geneticMap probability == expected # of events
-    double rate = records_.back().geneticMap * .01; // cM * .01 = probability
-    double total = 0;
-    for (unsigned int i=0; i<10; i++)
-    {     
-        total += exp(-rate)*pow(rate, double(i))/factorial(i);
-        recombinationEventDistribution_.push_back(total);
+    const size_t count = positions_.size();
+    geneticMapMax_ = storage->region.get() ?
+        reinterpret_cast<const BinaryHeader*>(storage->region->get_address())->geneticMapMax :
+        geneticMap_cM[count-1];
+
+    // geneticMap in storage units: used in place if mapped and stored as double,
+    // otherwise converted
+
+    const bool fixed_point = numeric_limits<GeneticMapValue>::is_integer;
+    if (fixed_point && geneticMapMax_ > 0)
+        geneticMapScale_ = numeric_limits<GeneticMapValue>::max() / geneticMapMax_;
+
+    if (storage->region.get() && sizeof(GeneticMapValue) == sizeof(double) && !fixed_point)
+    {
+        geneticMap_ = Span<GeneticMapValue>(reinterpret_cast<const GeneticMapValue*>(geneticMap_cM), count);
+    }
+    else
+    {
+        storage->geneticMap.reserve(count);
+        for (const double* it=geneticMap_cM; it!=geneticMap_cM+count; ++it)
+            storage->geneticMap.push_back(static_cast<GeneticMapValue>(*it * geneticMapScale_ + (fixed_point ? .5 : 0)));
+        geneticMap_ = Span<GeneticMapValue>(storage->geneticMap.data(), count);
     }
 }
 
 
-namespace {
-
-struct HasLowerGeneticMap
+void RecombinationMap::write_binary(const string& filename) const
 {
-    bool operator()(const RecombinationMap::Record& a, const RecombinationMap::Record& b)
+    ofstream os(filename.c_str(), ios::binary);
+    if (!os) throw runtime_error(("[RecombinationMap::write_binary()] Unable to open file " + filename).c_str());
+
+    BinaryHeader header;
+    copy(binary_magic_, binary_magic_+sizeof(binary_magic_), header.magic);
+    header.count = positions_.size();
+    header.geneticMapMax = geneticMapMax_;
+    header.reserved = 0;
+    os.write((const char*)&header, sizeof(header));
+
+    for (Span<GeneticMapValue>::const_iterator it=geneticMap_.begin(); it!=geneticMap_.end(); ++it)
     {
-        return a.geneticMap < b.geneticMap;
+        double cM = *it / geneticMapScale_;
+        os.write((const char*)&cM, sizeof(double));
     }
-};
 
-} // namespace
+    for (Span<unsigned int>::const_iterator it=positions_.begin(); it!=positions_.end(); ++it)
+    {
+        uint32_t position = *it;
+        os.write((const char*)&position, sizeof(uint32_t));
+    }
+
+    if (!os) throw runtime_error(("[RecombinationMap::write_binary()] Error writing file " + filename).c_str());
+}
+
+
+bool RecombinationMap::is_binary(const string& filename)
+{
+    ifstream is(filename.c_str(), ios::binary);
+    char magic[sizeof(binary_magic_)];
+    is.read(magic, sizeof(magic));
+    return is && equal(magic, magic+sizeof(magic), binary_magic_);
+}
 
 
 unsigned int RecombinationMap::random_position()
 {
-    // roll randomly into the distribution, using binary search
+    return random_position(random_);
+}
 
-    double max = records_.back().geneticMap;
-    double roll = random_.uniform(0, max);
 
-    Records::const_iterator it = lower_bound(records_.begin(), records_.end(),
-                                             Record(0, 0, roll), HasLowerGeneticMap());
+vector<unsigned int> RecombinationMap::random_positions()
+{
+    return random_positions(random_);
+}
 
-    if (it == records_.begin() || it == records_.end())
-        throw runtime_error("[RecombinationMap::random_position()] This isn't happening.");
 
-    // pick a position uniformly between two map positions
+unsigned int RecombinationMap::random_position(const Random& random) const
+{
+    return position(random.uniform(0, geneticMapMax_));
+}
 
-    unsigned int range_begin = (it-1)->position;
-    unsigned int range_end = it->position - 1;
-    unsigned int result = random_.randint(range_begin, range_end);
 
-    return result;
+void RecombinationMap::build_index(size_t bucket_count)
+{
+    // zero-length map: buckets would have zero width, so leave it unindexed
+    // (lookups use the plain binary search)
+
+    if (!(geneticMap_.back() > 0))
+    {
+        bucketBegin_.clear();
+        bucketWidth_ = 0;
+        return;
+    }
+
+    if (bucket_count == 0) bucket_count = geneticMap_.size();
+
+    bucketWidth_ = double(geneticMap_.back()) / bucket_count;
+    bucketBegin_.resize(bucket_count + 1);
+
+    // single pass: bucket boundaries and geneticMap are both increasing
+
+    Span<GeneticMapValue>::const_iterator it = geneticMap_.begin();
+    for (size_t b=0; b<=bucket_count; ++b)
+    {
+        const double boundary = b * bucketWidth_;
+        while (it != geneticMap_.end() && double(*it) < boundary) ++it;
+        bucketBegin_[b] = static_cast<unsigned int>(it - geneticMap_.begin());
+    }
 }
 
 
-vector<unsigned int> RecombinationMap::random_positions()
+unsigned int RecombinationMap::position(double roll) const
 {
-    // random number of events, according to recombinationEventDistribution_
+    const double scaled_roll = roll * geneticMapScale_;
+    const GeneticMapValue key = static_cast<GeneticMapValue>(scaled_roll);
+
+    // find key in the distribution: binary search within the key's bucket if
+    // indexed, otherwise over the whole map
+
+    Span<GeneticMapValue>::const_iterator begin = geneticMap_.begin();
+    Span<GeneticMapValue>::const_iterator end = geneticMap_.end();
+
+    if (!bucketBegin_.empty())
+    {
+        // lower_bound(key) lies in [bucketBegin_[b], bucketBegin_[b+1]] when
+        // b*bucketWidth_ <= key < (b+1)*bucketWidth_; adjust b for rounding
+
+        const double x = double(key);
+        const size_t last = bucketBegin_.size() - 2;
+        size_t b = std::min(static_cast<size_t>(x / bucketWidth_), last);
+        while (b > 0 && x < b * bucketWidth_) --b;
+        while (b < last && x >= (b+1) * bucketWidth_) ++b;
+
+        begin = geneticMap_.begin() + bucketBegin_[b];
+        end = geneticMap_.begin() + std::min(size_t(bucketBegin_[b+1]) + 1, geneticMap_.size());
+    }
 
-    double roll = random_.random();
-    vector<double>::const_iterator it = lower_bound(recombinationEventDistribution_.begin(),
-                                                    recombinationEventDistribution_.end(),
-                                                    roll);
-    size_t count = it - recombinationEventDistribution_.begin();
+    Span<GeneticMapValue>::const_iterator it = lower_bound(begin, end, key);
 
-    // pick random positions
+    // key 0 (reachable with reduced precision storage): first interval
+    if (it == geneticMap_.begin() && geneticMap_.size() > 1) ++it;
 
+    if (it == geneticMap_.begin() || it == geneticMap_.end())
+        throw runtime_error("[RecombinationMap::random_position()] This isn't happening.");
+
+    // pick a position uniformly between two map positions: the roll is uniform
+    // within [geneticMap_[index-1], geneticMap_[index]), so its fraction of the
+    // interval is uniform in [0,1)
+
+    const size_t index = it - geneticMap_.begin();
+    const double interval_begin = double(geneticMap_[index-1]);
+    const double interval_width = double(geneticMap_[index]) - interval_begin;
+    double fraction = interval_width > 0 ? (scaled_roll - interval_begin) / interval_width : 0;
+    fraction = std::max(0., std::min(fraction, 1.)); // reduced precision storage
+
+    const unsigned int range_begin = positions_[index-1];
+    const unsigned int range_end = positions_[index] - 1;
+    if (range_end < range_begin)
+        throw runtime_error("[RecombinationMap::random_position()] Empty range.");
+
+    const unsigned int range_size = range_end - range_begin + 1;
+    return range_begin + std::min(static_cast<unsigned int>(fraction * range_size), range_size - 1);
+}
+
+
+vector<unsigned int> RecombinationMap::random_positions(const Random& random) const
+{
     vector<unsigned int> result;
-    for (size_t i=0; i<count; i++)
-        result.push_back(random_position());
+    random_positions(random, result);
     return result;
 }
 
 
+void RecombinationMap::random_positions(const Random& random, vector<unsigned int>& positions) const
+{
+    // random number of events: Poisson, with
+    // rate == cumulative geneticMap probability == expected # of events
+
+    const size_t count = random.poisson(geneticMapMax_ * .01); // cM * .01 = probability
+    positions.resize(count);
+
+    if (count == 0) return;
+
+    // uniforms drawn in one bulk call, into a per-thread buffer that is reused
+    // across calls
+
+    static thread_local vector<double> rolls;
+    rolls.resize(count);
+    random.random(rolls.data(), rolls.data() + count);
+
+    // sorted rolls without sorting: the largest of i uniforms on [0,1) is distributed
+    // as U^(1/i), so the order statistics are drawn from the top down; position() is
+    // monotone, so the positions come out sorted
+
+    double top = 1;
+    for (size_t i=count; i>0; --i)
+    {
+        const double roll = rolls[count-i];
+        top *= (i == 1) ? roll : pow(roll, 1./i);
+        positions[i-1] = position(top * geneticMapMax_);
+    }
+}
+
+
 istream& operator>>(istream& is, RecombinationMap::Record& r)
 {
     is >> r.position >> r.combinedRate >> r.geneticMap;
@@ -21,17 +21,31 @@
 
 
 #include "Random.hpp"
+#include "Span.hpp"
+#include "shared_ptr.hpp"
 #include <vector>
 #include <string>
+#include <stdint.h>
 
 
 class RecombinationMap
 {
     public:
 
-    // construct with filename "genetic_map_..."
+    // construct with filename "genetic_map_..." (HapMap text), or the filename of
+    // a binary map written by write_binary() (memory-mapped, not parsed)
     RecombinationMap(const std::string& filename, const Random& random);
 
+    //
+    // binary map format (native byte order), laid out so that the arrays can be
+    // used directly from a memory-mapped file:
+    //     char[8] magic "SRGMAP01", uint64 count, double geneticMapMax, uint64 reserved
+    //     double geneticMap[count] (cM)
+    //     uint32 position[count]
+    //
+    void write_binary(const std::string& filename) const;
+    static bool is_binary(const std::string& filename);
+
     //
     // HapMap recombination rate 3-column data from files "genetic_map_*":
     //     position COMBINED_rate (cM/Mb) Genetic_Map(cM)
@@ -50,20 +64,70 @@ class RecombinationMap
             geneticMap(_geneticMap)
         {}
     };
-    
-    typedef std::vector<Record> Records;
-    Records records() const {return records_;}    
+
+    //
+    // The map is stored as two contiguous arrays (struct-of-arrays): record positions,
+    // and the cumulative geneticMap values used for the search.  The geneticMap storage
+    // type is chosen at compile time:
+    //     default:                        double, in cM
+    //     SIMRECOMB_GENETIC_MAP_FLOAT:    float, in cM (half the memory)
+    //     SIMRECOMB_GENETIC_MAP_FIXED:    uint32_t, fixed-point fraction of the map total
+    //
+#if defined(SIMRECOMB_GENETIC_MAP_FIXED)
+    typedef uint32_t GeneticMapValue;
+#elif defined(SIMRECOMB_GENETIC_MAP_FLOAT)
+    typedef float GeneticMapValue;
+#else
+    typedef double GeneticMapValue;
+#endif
+
+    size_t size() const {return positions_.size();}
+    const Span<unsigned int>& positions() const {return positions_;}
+    const Span<GeneticMapValue>& geneticMap() const {return geneticMap_;} // storage units
+
+    // total map length (cM)
+    double geneticMapMax() const {return geneticMapMax_;}
 
     // return a single random position
     unsigned int random_position();
 
-    // return multiple random positions
+    // return multiple random positions, sorted
     std::vector<unsigned int> random_positions();
 
+    // same as above, drawing from the specified Random instead of our own
+    // (safe to call concurrently with independent Random objects)
+    unsigned int random_position(const Random& random) const;
+    std::vector<unsigned int> random_positions(const Random& random) const;
+
+    // same, writing into a caller-owned buffer (no allocation once its capacity
+    // has grown to the largest event count)
+    void random_positions(const Random& random, std::vector<unsigned int>& positions) const;
+
+    // optional index: bucket_count uniform buckets over [0, max geneticMap], each
+    // mapping to the small range of records it covers, so that a position lookup is
+    // near-constant time instead of a binary search over all records; results are
+    // identical with or without the index (bucket_count 0: one bucket per record);
+    // a map of zero genetic length is left unindexed
+    void build_index(size_t bucket_count = 0);
+    bool indexed() const {return !bucketBegin_.empty();}
+
     private:
     const Random& random_;
-    Records records_;
-    std::vector<double> recombinationEventDistribution_;
+    shared_ptr<const void> storage_; // owns the arrays: vectors, or mapped binary file
+    Span<unsigned int> positions_;
+    Span<GeneticMapValue> geneticMap_;
+    double geneticMapMax_;
+    double geneticMapScale_; // cM -> GeneticMapValue storage units
+
+    // index: records in bucket b begin at bucketBegin_[b] (first record with
+    // geneticMap >= b*bucketWidth_, in storage units); bucketBegin_.size() == bucket count + 1
+    std::vector<unsigned int> bucketBegin_;
+    double bucketWidth_;
+
+    // position for a roll into the geneticMap distribution: the record interval is
+    // found by search, and the roll's fraction of the interval picks a position
+    // uniformly within it, so the mapping is monotone in roll
+    unsigned int position(double roll) const;
 };
 
 
@@ -19,8 +19,13 @@
 #include "RecombinationMap.hpp"
 #include "unit.hpp"
 #include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+#include <fstream>
 #include <iterator>
 #include <cstring>
+#include <cstdio>
+#include <algorithm>
 
 
 using namespace std;
@@ -33,7 +38,10 @@ void test()
 {
     Random random;
     RecombinationMap r("genetic_map_chr21_b36.txt", random);
-    unit_assert(r.records().size() == 44250);
+    unit_assert(r.size() == 44250);
+    unit_assert(r.positions().size() == r.size() && r.geneticMap().size() == r.size());
+    unit_assert(r.positions().front() == 9887804 && r.positions().back() == 46924583);
+    unit_assert_equal(r.geneticMapMax(), 62.2981473755, 1e-9);
 
     for (int i=0; i<10; i++) 
     {
@@ -48,12 +56,163 @@ void test()
 }
 
 
+void test_sorted()
+{
+    if (os_) *os_ << "test_sorted()\n";
+
+    Random random(7);
+    RecombinationMap r("genetic_map_chr21_b36.txt", random);
+
+    // positions come out sorted, in the map range, with Poisson(map length) count
+
+    vector<unsigned int> positions;
+    const size_t n = 100000;
+    size_t total = 0;
+
+    for (size_t i=0; i<n; ++i)
+    {
+        r.random_positions(random, positions);
+        total += positions.size();
+        for (size_t j=0; j<positions.size(); ++j)
+        {
+            unit_assert(positions[j] >= r.positions().front() && positions[j] < r.positions().back());
+            if (j > 0) unit_assert(positions[j-1] <= positions[j]);
+        }
+    }
+
+    unit_assert_equal(double(total)/n, r.geneticMapMax() * .01, .01);
+
+    // first half of the map in cM holds about half of the events
+
+    const size_t half = lower_bound(r.geneticMap().begin(), r.geneticMap().end(),
+                                    r.geneticMap().back()/2) - r.geneticMap().begin();
+    size_t below = 0;
+    for (size_t i=0; i<n; ++i)
+        if (r.random_position(random) < r.positions()[half]) ++below;
+    unit_assert_equal(double(below)/n, .5, .01);
+}
+
+
+void test_binary()
+{
+    if (os_) *os_ << "test_binary()\n";
+
+    Random random;
+    RecombinationMap text("genetic_map_chr21_b36.txt", random);
+    unit_assert(!RecombinationMap::is_binary("genetic_map_chr21_b36.txt"));
+
+    const char* filename = "RecombinationMapTest.temp.map";
+    text.write_binary(filename);
+    unit_assert(RecombinationMap::is_binary(filename));
+
+    {
+        RecombinationMap binary(filename, random);
+        unit_assert(binary.size() == text.size());
+        unit_assert(equal(binary.positions().begin(), binary.positions().end(), text.positions().begin()));
+        unit_assert(equal(binary.geneticMap().begin(), binary.geneticMap().end(), text.geneticMap().begin()));
+        unit_assert(binary.geneticMapMax() == text.geneticMapMax());
+
+        for (unsigned int seed=0; seed<100; ++seed)
+            unit_assert(text.random_positions(Random(seed)) == binary.random_positions(Random(seed)));
+    }
+
+    // corrupt count: large enough to overflow count * record size
+
+    {
+        fstream fs(filename, ios::in | ios::out | ios::binary);
+        const uint64_t count = uint64_t(1) << 62;
+        fs.seekp(8);
+        fs.write((const char*)&count, sizeof(count));
+    }
+
+    unit_assert_throws(RecombinationMap(filename, random), runtime_error);
+
+    remove(filename);
+
+    // missing or empty text file
+
+    unit_assert_throws(RecombinationMap("RecombinationMapTest.missing.txt", random), runtime_error);
+
+    {
+        ofstream os(filename);
+        os << "position COMBINED_rate(cM/Mb) Genetic_Map(cM)\n";
+    }
+
+    unit_assert_throws(RecombinationMap(filename, random), runtime_error);
+
+    remove(filename);
+}
+
+
+void test_index()
+{
+    if (os_) *os_ << "test_index()\n";
+
+    Random random;
+    RecombinationMap r("genetic_map_chr21_b36.txt", random);
+    RecombinationMap indexed("genetic_map_chr21_b36.txt", random);
+    unit_assert(!indexed.indexed());
+
+    // index gives the same positions as the full binary search, for any bucket count
+
+    const size_t bucket_counts[] = {0, 1, 7, 1000, 200000};
+    for (size_t i=0; i<sizeof(bucket_counts)/sizeof(size_t); ++i)
+    {
+        indexed.build_index(bucket_counts[i]);
+        unit_assert(indexed.indexed());
+
+        for (unsigned int seed=0; seed<200; ++seed)
+        {
+            Random a(seed, 1), b(seed, 1);
+            for (int j=0; j<20; ++j)
+                unit_assert(r.random_position(a) == indexed.random_position(b));
+            unit_assert(r.random_positions(a) == indexed.random_positions(b));
+        }
+    }
+}
+
+
+void test_index_zero_length()
+{
+    if (os_) *os_ << "test_index_zero_length()\n";
+
+    const char* filename = "RecombinationMapTest.zero.txt";
+    {
+        ofstream os(filename);
+        os << "position COMBINED_rate(cM/Mb) Genetic_Map(cM)\n"
+           << "100 0 0\n"
+           << "200 0 0\n"
+           << "300 0 0\n";
+    }
+
+    Random random;
+    RecombinationMap r(filename, random);
+    unit_assert(r.geneticMapMax() == 0);
+
+    // no buckets to build: stays unindexed, and draws no events
+
+    r.build_index();
+    unit_assert(!r.indexed());
+    r.build_index(10);
+    unit_assert(!r.indexed());
+
+    for (unsigned int seed=0; seed<100; ++seed)
+        unit_assert(r.random_positions(Random(seed, 1)).empty());
+
+    remove(filename);
+}
+
+
 int main(int argc, char* argv[])
 {
     try
     {
         if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
         test();
+        test_sorted();
+        test_binary();
+        test_index();
+        test_index_zero_length();
         return 0;
     }
     catch(exception& e)
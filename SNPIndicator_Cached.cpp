@@ -0,0 +1,122 @@
+//
+// SNPIndicator_Cached.cpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+
+#include "SNPIndicator_Cached.hpp"
+#include <stdexcept>
+#include <algorithm>
+
+
+using namespace std;
+
+
+SNPIndicator_Cached::SNPIndicator_Cached(const SNPIndicatorPtr& indicator, const vector<size_t>& founder_counts)
+:   indicator_(indicator), rowBegin_(1, 0), evaluation_count_(0)
+{
+    if (!indicator_.get()) throw runtime_error("[SNPIndicator_Cached] Null SNPIndicator.");
+
+    for (vector<size_t>::const_iterator it=founder_counts.begin(); it!=founder_counts.end(); ++it)
+        rowBegin_.push_back(rowBegin_.back() + 2*(*it));
+}
+
+
+unsigned int SNPIndicator_Cached::operator()(DNABlock::EncodedID chromosome_id, const Locus& locus) const
+{
+    unsigned int value = 0;
+    alleles(&chromosome_id, 1, locus, &value);
+    return value;
+}
+
+
+void SNPIndicator_Cached::alleles(const DNABlock::EncodedID* chromosome_ids, size_t count,
+                                  const Locus& locus, unsigned int* values) const
+{
+    LocusTable& locus_table = table(locus);
+
+    // read the table; ids not found (misses and non-founders) go to the wrapped
+    // indicator in a single call, once each
+
+    static thread_local vector<size_t> missing_indices;
+    static thread_local vector<DNABlock::EncodedID> missing_ids;
+    static thread_local vector<unsigned int> missing_values;
+    missing_indices.clear();
+
+    for (size_t i=0; i<count; ++i)
+    {
+        const size_t r = row(chromosome_ids[i], locus);
+        const unsigned char entry = r < row_count() ? locus_table[r].load(memory_order_relaxed) : 0;
+
+        if (entry)
+            values[i] = entry - 1;
+        else
+            missing_indices.push_back(i);
+    }
+
+    if (missing_indices.empty()) return;
+
+    missing_ids.clear();
+    for (vector<size_t>::const_iterator it=missing_indices.begin(); it!=missing_indices.end(); ++it)
+        missing_ids.push_back(chromosome_ids[*it]);
+    sort(missing_ids.begin(), missing_ids.end());
+    missing_ids.erase(unique(missing_ids.begin(), missing_ids.end()), missing_ids.end());
+
+    missing_values.resize(missing_ids.size());
+    indicator_->alleles(&missing_ids[0], missing_ids.size(), locus, &missing_values[0]);
+
+    for (size_t j=0; j<missing_ids.size(); ++j)
+    {
+        const size_t r = row(missing_ids[j], locus);
+        if (r < row_count())
+            locus_table[r].store((unsigned char)(missing_values[j] + 1), memory_order_relaxed);
+    }
+
+    for (vector<size_t>::const_iterator it=missing_indices.begin(); it!=missing_indices.end(); ++it)
+    {
+        const size_t j = lower_bound(missing_ids.begin(), missing_ids.end(), chromosome_ids[*it]) - missing_ids.begin();
+        values[*it] = missing_values[j];
+    }
+
+    evaluation_count_ += missing_ids.size();
+}
+
+
+SNPIndicator_Cached::LocusTable& SNPIndicator_Cached::table(const Locus& locus) const
+{
+    lock_guard<mutex> lock(mutex_);
+    shared_ptr<LocusTable>& result = tables_[locus];
+    if (!result.get()) result.reset(new LocusTable(row_count()));
+    return *result;
+}
+
+
+size_t SNPIndicator_Cached::row(DNABlock::EncodedID chromosome_id, const Locus& locus) const
+{
+    // founder chromosomes of pair k carry pair k in their ids
+
+    Chromosome::ID id(chromosome_id);
+
+    if (id.population+1 < rowBegin_.size() && id.pair == locus.chromosome_pair_index)
+    {
+        const size_t result = rowBegin_[id.population] + 2*size_t(id.individual) + id.which;
+        if (result < rowBegin_[id.population+1]) return result;
+    }
+
+    return row_count();
+}
+
+
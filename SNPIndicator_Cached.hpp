@@ -0,0 +1,83 @@
+//
+// SNPIndicator_Cached.hpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+
+#ifndef _SNPINDICATOR_CACHED_HPP_
+#define _SNPINDICATOR_CACHED_HPP_
+
+
+#include "Genotyper.hpp"
+#include "shared_ptr.hpp"
+#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+
+//
+// SNPIndicator_Cached: remembers the allele of each (founder haplotype, locus)
+// looked up through it, so that the wrapped SNPIndicator is evaluated once per
+// founder haplotype and locus, instead of once per descendant per generation
+//
+// Founders are given as individual counts per population id (individuals
+// [0, n_p) of population p, as created by Population::create_organisms()).  Each
+// locus gets a dense table with one byte per founder haplotype, filled in as
+// lookups miss; ids outside the founders go straight to the wrapped indicator.
+// Memory: 2 * sum(n_p) bytes per locus looked up.
+//
+// Block ids are immutable founder labels, so cached values never go stale; the
+// cache lives as long as the indicator (e.g. the whole simulation).  Safe to call
+// concurrently: a lock is taken once per batch to find the locus table, and table
+// entries are read and written without locks (threads missing the same entry at
+// the same time both evaluate it, so the wrapped indicator must be deterministic).
+//
+class SNPIndicator_Cached final : public SNPIndicator
+{
+    public:
+
+    SNPIndicator_Cached(const SNPIndicatorPtr& indicator, const std::vector<size_t>& founder_counts);
+
+    virtual unsigned int operator()(DNABlock::EncodedID chromosome_id, const Locus& locus) const;
+
+    virtual void alleles(const DNABlock::EncodedID* chromosome_ids, size_t count,
+                         const Locus& locus, unsigned int* values) const;
+
+    // number of times the wrapped indicator has been evaluated (cache misses)
+    size_t evaluation_count() const {return evaluation_count_;}
+
+    private:
+
+    // per founder haplotype: 0 not evaluated yet, else allele + 1
+    typedef std::vector< std::atomic<unsigned char> > LocusTable;
+
+    SNPIndicatorPtr indicator_;
+    std::vector<size_t> rowBegin_; // first haplotype of each founder population
+
+    mutable std::mutex mutex_; // guards tables_ (not the LocusTables)
+    mutable std::map< Locus, shared_ptr<LocusTable> > tables_;
+    mutable std::atomic<size_t> evaluation_count_;
+
+    LocusTable& table(const Locus& locus) const;
+    size_t row(DNABlock::EncodedID chromosome_id, const Locus& locus) const; // row_count() if not a founder
+    size_t row_count() const {return rowBegin_.back();}
+};
+
+
+#endif //  _SNPINDICATOR_CACHED_HPP_
+
+
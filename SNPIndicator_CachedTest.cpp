@@ -0,0 +1,255 @@
+//
+// SNPIndicator_CachedTest.cpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+#include "SNPIndicator_Cached.hpp"
+#include "unit.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+
+
+using namespace std;
+
+
+ostream* os_ = 0;
+//ostream* os_ = &cout;
+
+
+// allele depends on founder individual and locus; counts its evaluations
+class SNPIndicator_Counting : public SNPIndicator
+{
+    public:
+
+    SNPIndicator_Counting() : count_(0) {}
+
+    virtual unsigned int operator()(DNABlock::EncodedID chromosome_id, const Locus& locus) const
+    {
+        ++count_;
+        Chromosome::ID id(chromosome_id);
+        if (id.population == 3) throw runtime_error("[SNPIndicator_Counting] Population 3.");
+        return (id.individual + id.which + locus.position/1000000) % 2;
+    }
+
+    size_t count() const {return count_;}
+
+    private:
+    mutable atomic<size_t> count_;
+};
+
+
+void test_lookup()
+{
+    if (os_) *os_ << "test_lookup()\n";
+
+    shared_ptr<SNPIndicator_Counting> counting(new SNPIndicator_Counting);
+    SNPIndicator_Cached cached(counting, vector<size_t>(1, 10));
+
+    const Locus locus(0, 2000000);
+    const Chromosome::ID a(0, 5, 0, 0), b(0, 6, 0, 1);
+
+    unit_assert(cached(a, locus) == (*counting)(a, locus));
+    unit_assert(cached(a, locus) == (*counting)(a, locus));
+    unit_assert(cached.evaluation_count() == 1);
+
+    // batch with repeated ids: one evaluation per new id
+
+    vector<DNABlock::EncodedID> ids;
+    for (size_t i=0; i<10; ++i)
+    {
+        ids.push_back(a);
+        ids.push_back(b);
+    }
+
+    vector<unsigned int> values(ids.size(), 7);
+    cached.alleles(&ids[0], ids.size(), locus, &values[0]);
+    unit_assert(cached.evaluation_count() == 2);
+    for (size_t i=0; i<ids.size(); ++i)
+        unit_assert(values[i] == (*counting)(ids[i], locus));
+
+    // loci are cached separately
+
+    cached(a, Locus(0, 3000000));
+    cached(a, Locus(0, 3000000));
+    unit_assert(cached.evaluation_count() == 3);
+
+    // ids outside the founders (another population, individual or chromosome
+    // pair) are evaluated every time
+
+    const Chromosome::ID c(0, 10, 0, 0), d(1, 0, 0, 0);
+    unit_assert(cached(c, locus) == (*counting)(c, locus));
+    unit_assert(cached(c, locus) == (*counting)(c, locus));
+    unit_assert(cached(d, locus) == (*counting)(d, locus));
+    unit_assert(cached.evaluation_count() == 6);
+
+    cached(a, Locus(1, 2000000));
+    unit_assert(cached.evaluation_count() == 7);
+
+    // a failed evaluation leaves nothing behind
+
+    const Chromosome::ID bad(3, 0, 0, 0);
+    ids.push_back(bad);
+    unit_assert_throws(cached.alleles(&ids[0], ids.size(), locus, &values[0]), runtime_error);
+    unit_assert_throws(cached(bad, locus), runtime_error);
+    unit_assert(cached.evaluation_count() == 7);
+
+    unit_assert_throws(SNPIndicator_Cached(SNPIndicatorPtr(), vector<size_t>()), runtime_error);
+}
+
+
+void test_generations()
+{
+    if (os_) *os_ << "test_generations()\n";
+
+    vector<string> filenames(2, "genetic_map_chr21_b36.txt");
+    Random random_map;
+
+    Organism::recombinationPositionGenerator_ =
+        shared_ptr<RecombinationPositionGenerator>(
+            new RecombinationPositionGenerator_RecombinationMap(filenames, random_map));
+
+    Population::Config config0;
+    config0.size = 30;
+    config0.chromosomePairCount = 2;
+
+    PopulationPtrsPtr populations(new PopulationPtrs);
+    populations->push_back(PopulationPtr(new Population));
+    populations->back()->create_organisms(config0);
+
+    Population::Configs configs(1);
+    configs[0].size = 200;
+    configs[0].matingDistribution.push_back(1, make_pair(0,0));
+
+    Loci loci;
+    for (unsigned int position=16000000; position<46000000; position+=3000000)
+    {
+        loci.insert(Locus(0, position));
+        loci.insert(Locus(1, position));
+    }
+
+    shared_ptr<SNPIndicator_Counting> counting(new SNPIndicator_Counting);
+    SNPIndicator_Cached cached(counting, vector<size_t>(1, config0.size));
+    Genotyper genotyper(3);
+    Random random(17);
+
+    // evaluations are bounded by founder haplotypes x loci (x threads, which may
+    // miss the same entry at once), whatever the population size and number of
+    // generations
+
+    for (size_t generation=0; generation<5; ++generation)
+    {
+        populations = Population::create_populations(configs, *populations, DataVectorPtrs(1), random);
+        const Population& population = *populations->front();
+
+        GenotypeMapPtr expected = genotyper.genotype(loci, population, *counting);
+        GenotypeMapPtr result = genotyper.genotype(loci, population, cached);
+
+        for (GenotypeMap::const_iterator it=expected->begin(); it!=expected->end(); ++it)
+            unit_assert(*result->at(it->first) == *it->second);
+
+        if (os_) *os_ << "generation " << generation << ": " << cached.evaluation_count() << " evaluations\n";
+        unit_assert(cached.evaluation_count() <= 3 * 2*config0.size * loci.size());
+    }
+
+    Organism::recombinationPositionGenerator_ = shared_ptr<RecombinationPositionGenerator>();
+}
+
+
+void test_concurrent()
+{
+    if (os_) *os_ << "test_concurrent()\n";
+
+    // many threads looking up the same loci and founders at once, in batches as
+    // the Genotyper does: values match the wrapped indicator, and each founder
+    // haplotype is evaluated at most once per thread
+
+    const size_t founder_count = 500;
+    const size_t thread_count = 8;
+    const size_t locus_count = 20;
+
+    shared_ptr<SNPIndicator_Counting> counting(new SNPIndicator_Counting);
+    SNPIndicator_Cached cached(counting, vector<size_t>(1, founder_count));
+
+    vector<DNABlock::EncodedID> ids;
+    for (size_t i=0; i<2*founder_count; ++i)
+        ids.push_back(Chromosome::ID(0, (i/2*7919) % founder_count, 0, i%2)); // shuffled
+
+    atomic<size_t> errors(0);
+
+    auto lookup = [&](size_t thread_index)
+    {
+        vector<unsigned int> values(ids.size());
+
+        for (size_t repeat=0; repeat<10; ++repeat)
+        for (size_t j=0; j<locus_count; ++j)
+        {
+            const Locus locus(0, unsigned((j + thread_index) % locus_count) * 1000000);
+            for (size_t begin=0; begin<ids.size(); begin+=128)
+            {
+                const size_t count = min(size_t(128), ids.size()-begin);
+                cached.alleles(&ids[begin], count, locus, &values[begin]);
+                for (size_t k=begin; k<begin+count; ++k)
+                    if (values[k] != (*counting)(ids[k], locus)) ++errors;
+            }
+        }
+    };
+
+    vector<thread> threads;
+    for (size_t i=0; i<thread_count; ++i)
+        threads.push_back(thread(lookup, i));
+    for (size_t i=0; i<thread_count; ++i)
+        threads[i].join();
+
+    if (os_) *os_ << cached.evaluation_count() << " evaluations\n";
+    unit_assert(errors == 0);
+    unit_assert(cached.evaluation_count() >= 2*founder_count*locus_count);
+    unit_assert(cached.evaluation_count() <= thread_count*2*founder_count*locus_count);
+}
+
+
+void test()
+{
+    test_lookup();
+    test_generations();
+    test_concurrent();
+}
+
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
+        test();
+        return 0;
+    }
+    catch(exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Caught unknown exception.\n";
+        return 1;
+    }
+}
+
+
@@ -0,0 +1,230 @@
+//
+// SNPIndicator_FounderMatrix.cpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+
+#include "SNPIndicator_FounderMatrix.hpp"
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+
+using namespace std;
+namespace bip = boost::interprocess;
+
+
+namespace {
+
+const char binary_magic_[8] = {'S', 'R', 'F', 'M', 'A', 'T', '0', '1'};
+
+struct BinaryHeader
+{
+    char magic[8];
+    uint64_t population_count;
+    uint64_t locus_count;
+    uint64_t row_count;
+};
+
+struct MatrixStorage
+{
+    shared_ptr<bip::mapped_region> region;
+    vector<uint64_t> rowBegin;
+    vector<uint64_t> loci;
+    vector<uint64_t> bits;
+};
+
+inline uint64_t locus_key(const Locus& locus)
+{
+    return uint64_t(locus.chromosome_pair_index) << 32 | locus.position;
+}
+
+inline size_t word_count(size_t row_count)
+{
+    return (row_count + 63) / 64;
+}
+
+} // namespace
+
+
+SNPIndicator_FounderMatrix::SNPIndicator_FounderMatrix(const string& filename)
+:   wordCount_(0)
+{
+    shared_ptr<MatrixStorage> storage(new MatrixStorage);
+    storage_ = storage;
+
+    if (is_binary(filename))
+    {
+        bip::file_mapping file(filename.c_str(), bip::read_only);
+        storage->region.reset(new bip::mapped_region(file, bip::read_only));
+
+        const char* data = static_cast<const char*>(storage->region->get_address());
+        const size_t data_size = storage->region->get_size();
+        const BinaryHeader* header = reinterpret_cast<const BinaryHeader*>(data);
+
+        // check the header counts one at a time against the words in the file, so
+        // that corrupt counts can't overflow the size computation
+
+        const uint64_t words = (data_size - sizeof(BinaryHeader)) / sizeof(uint64_t);
+
+        if (data_size < sizeof(BinaryHeader) ||
+            (data_size - sizeof(BinaryHeader)) % sizeof(uint64_t) != 0 ||
+            header->population_count >= words ||
+            header->locus_count > words - header->population_count - 1 ||
+            header->row_count / 64 > words ||
+            (header->locus_count && word_count(header->row_count) > words / header->locus_count - 1) ||
+            words != header->population_count + 1 + header->locus_count * (1 + word_count(header->row_count)))
+            throw runtime_error(("[SNPIndicator_FounderMatrix] Bad binary matrix file " + filename).c_str());
+
+        const uint64_t* arrays = reinterpret_cast<const uint64_t*>(data + sizeof(BinaryHeader));
+        wordCount_ = word_count(header->row_count);
+        rowBegin_ = Span<uint64_t>(arrays, header->population_count + 1);
+        loci_ = Span<uint64_t>(rowBegin_.end(), header->locus_count);
+        bits_ = Span<uint64_t>(loci_.end(), header->locus_count * wordCount_);
+
+        // row ranges must be in order and within the matrix, since row() trusts them
+
+        bool rows_ok = rowBegin_.back() == header->row_count;
+        for (size_t i=1; rows_ok && i<rowBegin_.size(); ++i)
+            rows_ok = rowBegin_[i-1] <= rowBegin_[i];
+
+        if (!rows_ok)
+            throw runtime_error(("[SNPIndicator_FounderMatrix] Bad binary matrix file " + filename).c_str());
+    }
+    else
+    {
+        ifstream is(filename.c_str());
+        if (!is) throw runtime_error(("[SNPIndicator_FounderMatrix] Unable to open file " + filename).c_str());
+
+        string tag;
+        size_t population_count = 0;
+        is >> tag >> population_count;
+        if (tag != "populations") throw runtime_error("[SNPIndicator_FounderMatrix] Expected \"populations\".");
+
+        storage->rowBegin.push_back(0);
+        for (size_t i=0; i<population_count; ++i)
+        {
+            size_t individual_count = 0;
+            is >> individual_count;
+            storage->rowBegin.push_back(storage->rowBegin.back() + 2*individual_count);
+        }
+
+        size_t locus_count = 0;
+        is >> tag >> locus_count;
+        if (tag != "loci") throw runtime_error("[SNPIndicator_FounderMatrix] Expected \"loci\".");
+
+        for (size_t i=0; i<locus_count; ++i)
+        {
+            Locus locus;
+            is >> locus.chromosome_pair_index >> locus.position;
+            storage->loci.push_back(locus_key(locus));
+            if (i>0 && storage->loci[i] <= storage->loci[i-1])
+                throw runtime_error("[SNPIndicator_FounderMatrix] Loci not sorted.");
+        }
+
+        const size_t row_count = storage->rowBegin.back();
+        wordCount_ = word_count(row_count);
+        storage->bits.resize(locus_count * wordCount_);
+
+        for (size_t row=0; row<row_count; ++row)
+        {
+            string haplotype;
+            is >> haplotype;
+            if (!is || haplotype.size() != locus_count)
+                throw runtime_error(("[SNPIndicator_FounderMatrix] Bad haplotype row in " + filename).c_str());
+
+            for (size_t column=0; column<locus_count; ++column)
+            {
+                if (haplotype[column] == '1')
+                    storage->bits[column*wordCount_ + row/64] |= uint64_t(1) << (row%64);
+                else if (haplotype[column] != '0')
+                    throw runtime_error("[SNPIndicator_FounderMatrix] Invalid allele.");
+            }
+        }
+
+        rowBegin_ = Span<uint64_t>(storage->rowBegin.data(), storage->rowBegin.size());
+        loci_ = Span<uint64_t>(storage->loci.data(), storage->loci.size());
+        bits_ = Span<uint64_t>(storage->bits.data(), storage->bits.size());
+    }
+
+    columns_.reserve(loci_.size());
+    for (size_t column=0; column<loci_.size(); ++column)
+        columns_[loci_[column]] = column;
+}
+
+
+void SNPIndicator_FounderMatrix::write_binary(const string& filename) const
+{
+    ofstream os(filename.c_str(), ios::binary);
+    if (!os) throw runtime_error(("[SNPIndicator_FounderMatrix::write_binary()] Unable to open file " + filename).c_str());
+
+    BinaryHeader header;
+    copy(binary_magic_, binary_magic_+sizeof(binary_magic_), header.magic);
+    header.population_count = population_count();
+    header.locus_count = locus_count();
+    header.row_count = row_count();
+    os.write((const char*)&header, sizeof(header));
+
+    os.write((const char*)rowBegin_.data(), sizeof(uint64_t)*rowBegin_.size());
+    os.write((const char*)loci_.data(), sizeof(uint64_t)*loci_.size());
+    os.write((const char*)bits_.data(), sizeof(uint64_t)*bits_.size());
+
+    if (!os) throw runtime_error(("[SNPIndicator_FounderMatrix::write_binary()] Error writing file " + filename).c_str());
+}
+
+
+bool SNPIndicator_FounderMatrix::is_binary(const string& filename)
+{
+    ifstream is(filename.c_str(), ios::binary);
+    char magic[sizeof(binary_magic_)];
+    is.read(magic, sizeof(magic));
+    return is && equal(magic, magic+sizeof(magic), binary_magic_);
+}
+
+
+Locus SNPIndicator_FounderMatrix::locus(size_t column) const
+{
+    const uint64_t key = loci_[column];
+    return Locus(size_t(key >> 32), unsigned(key & 0xffffffff));
+}
+
+
+size_t SNPIndicator_FounderMatrix::row(DNABlock::EncodedID chromosome_id) const
+{
+    Chromosome::ID id(chromosome_id);
+
+    if (id.population < population_count())
+    {
+        const size_t result = rowBegin_[id.population] + 2*size_t(id.individual) + id.which;
+        if (result < rowBegin_[id.population+1]) return result;
+    }
+
+    throw runtime_error("[SNPIndicator_FounderMatrix] Chromosome id not in founder matrix.");
+}
+
+
+size_t SNPIndicator_FounderMatrix::column(const Locus& locus) const
+{
+    unordered_map<uint64_t, size_t>::const_iterator it = columns_.find(locus_key(locus));
+    if (it == columns_.end())
+        throw runtime_error("[SNPIndicator_FounderMatrix] Locus not in founder matrix.");
+    return it->second;
+}
+
+
@@ -0,0 +1,107 @@
+//
+// SNPIndicator_FounderMatrix.hpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+
+#ifndef _SNPINDICATOR_FOUNDERMATRIX_HPP_
+#define _SNPINDICATOR_FOUNDERMATRIX_HPP_
+
+
+#include "Genotyper.hpp"
+#include "Span.hpp"
+#include "shared_ptr.hpp"
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+
+//
+// SNPIndicator_FounderMatrix: alleles of the founder haplotypes at a set of loci,
+// from a bit-packed matrix with one row per founder haplotype and one column per
+// locus
+//
+// Rows are ordered by (population, individual, which), with individuals [0, n_p)
+// for founder population p (as created by Population::create_organisms() with
+// idOffset 0).  The matrix is stored dense, column-major: each locus column is
+// word_count = (row_count+63)/64 contiguous 64-bit words.  A lookup decodes the
+// chromosome id into a row and reads one bit of the locus's column; the column
+// index comes from a locus -> column hash table built on construction, and the
+// batch lookup does it once per call.  Ids or loci outside the matrix are
+// errors.
+//
+class SNPIndicator_FounderMatrix final : public SNPIndicator
+{
+    public:
+
+    // filename: text or binary matrix (see below); binary files are memory-mapped
+    SNPIndicator_FounderMatrix(const std::string& filename);
+
+    //
+    // text format (whitespace separated):
+    //     populations <population_count> <n_0> <n_1> ...
+    //     loci <locus_count>
+    //     <chromosome_pair_index> <position>      (locus_count lines, sorted)
+    //     <haplotype>                              (2*sum(n_p) rows of '0'/'1', one per locus)
+    //
+    // binary format (native byte order), used in place from a memory-mapped file:
+    //     char[8] magic "SRFMAT01", uint64 population_count, uint64 locus_count, uint64 row_count
+    //     uint64 row_begin[population_count+1]     (first row of each population)
+    //     uint64 locus[locus_count]                (chromosome_pair_index << 32 | position)
+    //     uint64 bits[locus_count][word_count]     (one column per locus, word_count = (row_count+63)/64)
+    //
+    void write_binary(const std::string& filename) const;
+    static bool is_binary(const std::string& filename);
+
+    size_t population_count() const {return rowBegin_.size() - 1;}
+    size_t row_count() const {return rowBegin_.back();}
+    size_t locus_count() const {return loci_.size();}
+    Locus locus(size_t column) const;
+
+    virtual unsigned int operator()(DNABlock::EncodedID chromosome_id, const Locus& locus) const
+    {
+        return bit(column(locus), row(chromosome_id));
+    }
+
+    virtual void alleles(const DNABlock::EncodedID* chromosome_ids, size_t count,
+                         const Locus& locus, unsigned int* values) const
+    {
+        const size_t c = column(locus);
+        for (size_t i=0; i<count; ++i)
+            values[i] = bit(c, row(chromosome_ids[i]));
+    }
+
+    private:
+
+    shared_ptr<const void> storage_; // owns the arrays: vectors, or mapped binary file
+    Span<uint64_t> rowBegin_;
+    Span<uint64_t> loci_;
+    Span<uint64_t> bits_;
+    size_t wordCount_; // per column
+    std::unordered_map<uint64_t, size_t> columns_; // locus key -> column
+
+    size_t row(DNABlock::EncodedID chromosome_id) const;
+    size_t column(const Locus& locus) const;
+
+    unsigned int bit(size_t column, size_t row) const
+    {
+        return unsigned(bits_[column*wordCount_ + row/64] >> (row%64) & 1);
+    }
+};
+
+
+#endif //  _SNPINDICATOR_FOUNDERMATRIX_HPP_
+
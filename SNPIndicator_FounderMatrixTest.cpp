@@ -0,0 +1,251 @@
+//
+// SNPIndicator_FounderMatrixTest.cpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+#include "SNPIndicator_FounderMatrix.hpp"
+#include "unit.hpp"
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+
+
+using namespace std;
+
+
+ostream* os_ = 0;
+//ostream* os_ = &cout;
+
+
+const char* text_filename_ = "SNPIndicator_FounderMatrixTest.temp.txt";
+const char* binary_filename_ = "SNPIndicator_FounderMatrixTest.temp.bin";
+
+
+// 2 founder populations (3 and 40 individuals), 4 loci; allele at (row, column)
+// is 1 iff (row + column) % 3 == 0, except population 0's first haplotype is all 1s
+unsigned int expected_allele(size_t row, size_t column)
+{
+    return (row == 0 || (row + column) % 3 == 0) ? 1 : 0;
+}
+
+
+void write_text_matrix()
+{
+    ofstream os(text_filename_);
+    os << "populations 2 3 40\n"
+       << "loci 4\n"
+       << "0 1000\n"
+       << "0 5000\n"
+       << "1 1000\n"
+       << "2 7\n";
+
+    for (size_t row=0; row<2*(3+40); ++row)
+    {
+        for (size_t column=0; column<4; ++column)
+            os << expected_allele(row, column);
+        os << endl;
+    }
+}
+
+
+void test_lookup(const SNPIndicator_FounderMatrix& matrix)
+{
+    unit_assert(matrix.population_count() == 2);
+    unit_assert(matrix.row_count() == 86);
+    unit_assert(matrix.locus_count() == 4);
+    unit_assert(matrix.locus(2) == Locus(1, 1000));
+
+    const Locus loci[] = {Locus(0, 1000), Locus(0, 5000), Locus(1, 1000), Locus(2, 7)};
+
+    for (size_t column=0; column<4; ++column)
+    {
+        vector<DNABlock::EncodedID> ids;
+        vector<unsigned int> expected;
+
+        for (unsigned int population=0; population<2; ++population)
+        for (unsigned int individual=0; individual<(population ? 40u : 3u); ++individual)
+        for (unsigned int which=0; which<2; ++which)
+        {
+            const size_t row = (population ? 6 : 0) + 2*individual + which;
+            const DNABlock::EncodedID id = Chromosome::ID(population, individual, loci[column].chromosome_pair_index, which);
+            unit_assert(matrix(id, loci[column]) == expected_allele(row, column));
+            ids.push_back(id);
+            expected.push_back(expected_allele(row, column));
+        }
+
+        vector<unsigned int> values(ids.size());
+        matrix.alleles(&ids[0], ids.size(), loci[column], &values[0]);
+        unit_assert(values == expected);
+    }
+
+    // ids and loci outside the matrix
+
+    unit_assert_throws(matrix(Chromosome::ID(0, 3, 0, 0), loci[0]), runtime_error);
+    unit_assert_throws(matrix(Chromosome::ID(2, 0, 0, 0), loci[0]), runtime_error);
+    unit_assert_throws(matrix(Chromosome::ID(0, 0, 0, 0), Locus(0, 1001)), runtime_error);
+}
+
+
+void test_text()
+{
+    if (os_) *os_ << "test_text()\n";
+
+    write_text_matrix();
+    unit_assert(!SNPIndicator_FounderMatrix::is_binary(text_filename_));
+
+    SNPIndicator_FounderMatrix matrix(text_filename_);
+    test_lookup(matrix);
+}
+
+
+void test_binary()
+{
+    if (os_) *os_ << "test_binary()\n";
+
+    {
+        SNPIndicator_FounderMatrix text(text_filename_);
+        text.write_binary(binary_filename_);
+    }
+
+    unit_assert(SNPIndicator_FounderMatrix::is_binary(binary_filename_));
+
+    SNPIndicator_FounderMatrix binary(binary_filename_);
+    test_lookup(binary);
+}
+
+
+void test_genotype()
+{
+    if (os_) *os_ << "test_genotype()\n";
+
+    SNPIndicator_FounderMatrix matrix(text_filename_);
+
+    Population::Config config;
+    config.size = 40;
+    config.chromosomePairCount = 3;
+    config.populationID = 1;
+
+    Population population;
+    population.create_organisms(config);
+
+    Loci loci;
+    for (size_t column=0; column<matrix.locus_count(); ++column)
+        loci.insert(matrix.locus(column));
+
+    GenotypeMapPtr genotypes = Genotyper(2).genotype(loci, population, matrix);
+
+    size_t column = 0;
+    for (Loci::const_iterator locus=loci.begin(); locus!=loci.end(); ++locus, ++column)
+    for (size_t i=0; i<population.size(); ++i)
+        unit_assert(genotypes->at(*locus)->at(i) == expected_allele(6+2*i, column) + expected_allele(6+2*i+1, column));
+}
+
+
+void test_errors()
+{
+    if (os_) *os_ << "test_errors()\n";
+
+    {
+        ofstream os(text_filename_);
+        os << "populations 1 1\nloci 2\n0 5\n0 3\n10\n01\n";
+    }
+    unit_assert_throws(SNPIndicator_FounderMatrix(text_filename_), runtime_error); // unsorted
+
+    {
+        ofstream os(text_filename_);
+        os << "populations 1 1\nloci 2\n0 3\n0 5\n10\n0\n";
+    }
+    unit_assert_throws(SNPIndicator_FounderMatrix(text_filename_), runtime_error); // short row
+
+    // binary header counts that would overflow the file size computation
+
+    {
+        ofstream os(text_filename_);
+        os << "populations 1 1\nloci 2\n0 3\n0 5\n10\n01\n";
+    }
+    SNPIndicator_FounderMatrix(text_filename_).write_binary(binary_filename_);
+    unit_assert(SNPIndicator_FounderMatrix(binary_filename_).locus_count() == 2);
+
+    const uint64_t corrupt[] = {uint64_t(1) << 62, ~uint64_t(0)};
+    for (size_t offset=8; offset<=24; offset+=8) // population_count, locus_count, row_count
+    for (size_t i=0; i<2; ++i)
+    {
+        SNPIndicator_FounderMatrix(text_filename_).write_binary(binary_filename_);
+        {
+            fstream fs(binary_filename_, ios::in | ios::out | ios::binary);
+            fs.seekp(offset);
+            fs.write((const char*)&corrupt[i], sizeof(uint64_t));
+        }
+        unit_assert_throws(SNPIndicator_FounderMatrix(binary_filename_), runtime_error);
+    }
+
+    // binary row ranges out of order, or past row_count: row_begin = {0, 2, 4}
+
+    {
+        ofstream os(text_filename_);
+        os << "populations 2 1 1\nloci 1\n0 3\n1\n0\n1\n0\n";
+    }
+
+    const size_t row_begin_offset = 32;
+    const uint64_t bad_rows[][2] = {{0, 3}, {1, 5}}; // {entry, value}
+    for (size_t i=0; i<2; ++i)
+    {
+        SNPIndicator_FounderMatrix(text_filename_).write_binary(binary_filename_);
+        unit_assert(SNPIndicator_FounderMatrix(binary_filename_).row_count() == 4);
+        {
+            fstream fs(binary_filename_, ios::in | ios::out | ios::binary);
+            fs.seekp(row_begin_offset + 8*bad_rows[i][0]);
+            fs.write((const char*)&bad_rows[i][1], sizeof(uint64_t));
+        }
+        unit_assert_throws(SNPIndicator_FounderMatrix(binary_filename_), runtime_error);
+    }
+}
+
+
+void test()
+{
+    test_text();
+    test_binary();
+    test_genotype();
+    test_errors();
+}
+
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc>1 && !strcmp(argv[1],"-v")) os_ = &cout;
+        test();
+        remove(text_filename_);
+        remove(binary_filename_);
+        return 0;
+    }
+    catch(exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Caught unknown exception.\n";
+        return 1;
+    }
+}
+
+
@@ -25,6 +25,9 @@
 #include "shared_ptr.hpp"
 #include <map>
 #include <string>
+#include <stdexcept>
+#include <cstdlib>
+#include <cerrno>
 
 
 class SimulationController
@@ -46,5 +49,39 @@ class SimulationController
 typedef shared_ptr<SimulationController> SimulationControllerPtr;
 
 
+// "threads" parameter: a positive integer (default: 1)
+inline size_t parse_thread_count(const SimulationController::Parameters& parameters)
+{
+    SimulationController::Parameters::const_iterator it = parameters.find("threads");
+    if (it == parameters.end()) return 1;
+
+    const std::string& value = it->second;
+    char* end = 0;
+    errno = 0;
+    const unsigned long result = std::strtoul(value.c_str(), &end, 10);
+
+    if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos || *end || errno == ERANGE || result < 1)
+        throw std::runtime_error(("[SimulationController] Invalid threads=" + value + " (must be a positive integer).").c_str());
+
+    return result;
+}
+
+
+// "sampler" parameter: binary_search or alias_table (default: binary_search)
+inline Sampler parse_sampler(const SimulationController::Parameters& parameters)
+{
+    SimulationController::Parameters::const_iterator it = parameters.find("sampler");
+    if (it == parameters.end() || it->second == "binary_search") return Sampler_BinarySearch;
+    if (it->second == "alias_table") return Sampler_AliasTable;
+    throw std::runtime_error(("[SimulationController] Invalid sampler=" + it->second + " (must be binary_search or alias_table).").c_str());
+}
+
+
+inline const char* sampler_name(Sampler sampler)
+{
+    return sampler == Sampler_AliasTable ? "alias_table" : "binary_search";
+}
+
+
 #endif //  _SIMULATIONCONTROLLER_HPP_
 
@@ -77,6 +77,8 @@ SimulationController_NeutralAdmixture::Config::Config(const Parameters& paramete
     population_config_filename = parameters.count("popconfig") ? parameters.at("popconfig") : "";
     genetic_map_list_filename = parameters.count("genetic_map_list") ? parameters.at("genetic_map_list") : "";
     output_directory = parameters.count("outdir") ? parameters.at("outdir") : "";
+    thread_count = parse_thread_count(parameters);
+    sampler = parse_sampler(parameters);
 }
 
 
@@ -99,6 +101,8 @@ void SimulationController_NeutralAdmixture::usage() const
     cout << "Optional parameters:\n";
     cout << "  config=<config_filename>\n";
     cout << "  seed=<value>\n";
+    cout << "  threads=<thread_count>                   (default: 1)\n";
+    cout << "  sampler=<binary_search|alias_table>      (default: binary_search)\n";
     cout << endl;
 }
 
@@ -134,8 +138,12 @@ void SimulationController_NeutralAdmixture::initialize()
     // initialize simulator
 
     simulator_config_.seed = config_.seed;
+    simulator_config_.thread_count = config_.thread_count;
+    simulator_config_.sampler = config_.sampler;
     
     cout << "seed: " << config_.seed << endl;
+    cout << "threads: " << config_.thread_count << endl;
+    cout << "sampler: " << sampler_name(config_.sampler) << endl;
     cout << "genetic maps:\n";
     copy(simulator_config_.genetic_map_filenames.begin(), simulator_config_.genetic_map_filenames.end(), ostream_iterator<string>(cout, "\n"));
     cout << endl;
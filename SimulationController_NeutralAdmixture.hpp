@@ -34,6 +34,8 @@ class SimulationController_NeutralAdmixture : public SimulationController
         std::string population_config_filename; // "popconfig"
         std::string genetic_map_list_filename;  // "genetic_map_list"
         std::string output_directory;           // "outdir"
+        size_t thread_count;                    // "threads"
+        Sampler sampler;                        // "sampler"
 
         Config(const Parameters& parameters = Parameters()); // allows auto conversion: Parameters->Config
     };
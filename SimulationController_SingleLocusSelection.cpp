@@ -210,7 +210,7 @@ class Reporter_Fitnesses : public Reporter
 };
 
 
-class SNPIndicator_SingleLocusHardyWeinberg : public SNPIndicator
+class SNPIndicator_SingleLocusHardyWeinberg final : public SNPIndicator
 {
     public:
 
@@ -229,7 +229,7 @@ class SNPIndicator_SingleLocusHardyWeinberg : public SNPIndicator
         max_1_ = size_t(N * (1 - q*q));
     }
 
-    virtual unsigned int operator()(unsigned int chromosome_id, const Locus& locus) const
+    virtual unsigned int operator()(DNABlock::EncodedID chromosome_id, const Locus& locus) const
     {
         if (locus != locus_) return 0;
         Chromosome::ID id(chromosome_id);
@@ -238,6 +238,19 @@ class SNPIndicator_SingleLocusHardyWeinberg : public SNPIndicator
         return 0; 
     }
 
+    virtual void alleles(const DNABlock::EncodedID* chromosome_ids, size_t count,
+                         const Locus& locus, unsigned int* values) const
+    {
+        if (locus != locus_)
+        {
+            fill(values, values+count, 0u);
+            return;
+        }
+
+        for (size_t i=0; i<count; ++i)
+            values[i] = SNPIndicator_SingleLocusHardyWeinberg::operator()(chromosome_ids[i], locus);
+    }
+
     private:
 
     Locus locus_;
@@ -298,6 +311,8 @@ SimulationController_SingleLocusSelection::Config::Config(const Parameters& para
     w[1] = parameters.count("w1") ? atof(parameters.at("w1").c_str()) : 1;
     w[2] = parameters.count("w2") ? atof(parameters.at("w2").c_str()) : 1;
 
+    thread_count = parse_thread_count(parameters);
+    sampler = parse_sampler(parameters);
     verbose = parameters.count("verbose"); // no good for verbose=0
 }
 
@@ -313,6 +328,8 @@ std::ostream& operator<<(std::ostream& os, const SimulationController_SingleLocu
     os << "w0 = " << config.w[0] << endl;
     os << "w1 = " << config.w[1] << endl;
     os << "w2 = " << config.w[2] << endl;
+    os << "threads = " << config.thread_count << endl;
+    os << "sampler = " << sampler_name(config.sampler) << endl;
     if (config.verbose) os << "verbose" << endl;
     return os;
 }
@@ -342,6 +359,8 @@ void SimulationController_SingleLocusSelection::SimulationController_SingleLocus
     cout << "  w0=<relative_fitness_genotype_0>         (default: w0=1)\n";
     cout << "  w1=<relative_fitness_genotype_1>         (default: w1=1)\n";
     cout << "  w2=<relative_fitness_genotype_2>         (default: w2=1)\n";
+    cout << "  threads=<thread_count>                   (default: 1)\n";
+    cout << "  sampler=<binary_search|alias_table>      (default: binary_search)\n";
     cout << "  verbose\n"; 
     cout << endl;
 }
@@ -408,6 +427,8 @@ void SimulationController_SingleLocusSelection::initialize()
 
     simulator_config_.seed = config_.seed;
     simulator_config_.output_directory = config_.output_directory;    
+    simulator_config_.thread_count = config_.thread_count;
+    simulator_config_.sampler = config_.sampler;
 
     // population configs
 
@@ -37,6 +37,8 @@ class SimulationController_SingleLocusSelection : public SimulationController
         size_t generation_count;                // "gencount"
         double initial_allele_frequency;        // "allelefreq"
         std::vector<double> w;                  // "w0", "w1", "w2" (relative fitnesses for genotype in {0,1,2})
+        size_t thread_count;                    // "threads"
+        Sampler sampler;                        // "sampler"
         bool verbose;                           // "verbose" (for debugging)
 
         Config(const Parameters& parameters = Parameters()); // allows auto conversion: Parameters->Config
@@ -30,9 +30,47 @@ ostream* os_ = 0;
 //ostream* os_ = &cout;
 
 
+void test_thread_count()
+{
+    if (os_) *os_ << "test_thread_count()\n";
+
+    SimulationController::Parameters parameters;
+    unit_assert(SimulationController_SingleLocusSelection::Config(parameters).thread_count == 1);
+
+    parameters["threads"] = "4";
+    unit_assert(SimulationController_SingleLocusSelection::Config(parameters).thread_count == 4);
+
+    const char* bad[] = {"", "0", "-1", "abc", "2x", "99999999999999999999999"};
+    for (size_t i=0; i<sizeof(bad)/sizeof(bad[0]); ++i)
+    {
+        parameters["threads"] = bad[i];
+        unit_assert_throws(SimulationController_SingleLocusSelection::Config(parameters).thread_count, runtime_error);
+    }
+}
+
+
+void test_sampler()
+{
+    if (os_) *os_ << "test_sampler()\n";
+
+    SimulationController::Parameters parameters;
+    unit_assert(SimulationController_SingleLocusSelection::Config(parameters).sampler == Sampler_BinarySearch);
+
+    parameters["sampler"] = "alias_table";
+    unit_assert(SimulationController_SingleLocusSelection::Config(parameters).sampler == Sampler_AliasTable);
+
+    parameters["sampler"] = "binary_search";
+    unit_assert(SimulationController_SingleLocusSelection::Config(parameters).sampler == Sampler_BinarySearch);
+
+    parameters["sampler"] = "alias";
+    unit_assert_throws(SimulationController_SingleLocusSelection::Config(parameters).sampler, runtime_error);
+}
+
+
 void test()
 {
-    cout << "we're here\n";
+    test_thread_count();
+    test_sampler();
 }
 
 
@@ -18,8 +18,10 @@
 
 
 #include "Simulator.hpp"
+#include "SNPIndicator_Cached.hpp"
 #include <iostream>
 #include <iterator>
+#include <algorithm>
 #include "boost/filesystem.hpp"
 #include "boost/filesystem/fstream.hpp"
 
@@ -36,6 +38,7 @@ namespace bfs = boost::filesystem;
 Simulator::Simulator(const Config& config)
 :   config_(config), 
     random_(config.seed),
+    genotyper_(config.thread_count),
     current_generation_(0), 
     current_populations_(new PopulationPtrs),
     current_population_datas_(new PopulationDatas)
@@ -47,6 +50,23 @@ Simulator::Simulator(const Config& config)
     if (!config_.snp_indicator.get())
         config_.snp_indicator = SNPIndicatorPtr(new SNPIndicator_Trivial);
 
+    if (config_.cache_snp_indicator)
+    {
+        // founders: the populations of generation 0
+
+        vector<size_t> founder_counts;
+
+        if (!config_.population_configs.empty())
+        for (Population::Configs::const_iterator it=config_.population_configs[0].begin();
+             it!=config_.population_configs[0].end(); ++it)
+        {
+            if (founder_counts.size() <= it->populationID) founder_counts.resize(it->populationID+1);
+            founder_counts[it->populationID] = max(founder_counts[it->populationID], it->idOffset + it->size);
+        }
+
+        config_.snp_indicator = SNPIndicatorPtr(new SNPIndicator_Cached(config_.snp_indicator, founder_counts));
+    }
+
     if (!config_.fitness_function.get())
         config_.fitness_function = FitnessFunctionPtr(new FitnessFunction_Trivial);
 
@@ -78,12 +98,27 @@ void Simulator::simulate_single_generation()
          popdata!=current_population_datas_->end(); ++popdata)
         fitnesses.push_back(popdata->fitnesses);
 
-    PopulationPtrsPtr next_populations = Population::create_populations(
-        config_.population_configs[current_generation_], *current_populations_, fitnesses, random_);
+    // double buffering: the next generation reuses the buffers of generation g-2,
+    // unless a reporter has held on to them
+
+    PopulationPtrsPtr next_populations = spare_populations_;
+    if (!next_populations.get() || next_populations.use_count() != 1)
+        next_populations = PopulationPtrsPtr(new PopulationPtrs);
+
+    PopulationDatasPtr next_population_datas = spare_population_datas_;
+    if (!next_population_datas.get() || next_population_datas.use_count() != 1)
+        next_population_datas = PopulationDatasPtr(new PopulationDatas);
+
+    spare_populations_.reset();
+    spare_population_datas_.reset();
+
+    Population::create_populations(*next_populations,
+        config_.population_configs[current_generation_], *current_populations_, fitnesses, random_,
+        config_.thread_count, config_.sampler);
 
     // collect data on the populations
 
-    PopulationDatasPtr next_population_datas(new PopulationDatas(next_populations->size()));
+    next_population_datas->resize(next_populations->size());
 
     // calculate genotypes
 
@@ -101,7 +136,10 @@ void Simulator::simulate_single_generation()
     for (PopulationDatas::iterator popdata=next_population_datas->begin();
          popdata!=next_population_datas->end(); ++popdata, ++population)
     {
-         popdata->genotypes = genotyper_.genotype(loci_all, **population, *config_.snp_indicator);
+        if (!popdata->genotypes.get() || popdata->genotypes.use_count() != 1)
+            popdata->genotypes = GenotypeMapPtr(new GenotypeMap);
+
+        genotyper_.genotype(loci_all, **population, *config_.snp_indicator, *popdata->genotypes);
     }
 
     // calculate quantitative trait values
@@ -109,7 +147,10 @@ void Simulator::simulate_single_generation()
     for (PopulationDatas::iterator popdata=next_population_datas->begin();
          popdata!=next_population_datas->end(); ++popdata)
     {
-        popdata->trait_values = TraitValueMapPtr(new TraitValueMap);
+        if (!popdata->trait_values.get() || popdata->trait_values.use_count() != 1)
+            popdata->trait_values = TraitValueMapPtr(new TraitValueMap);
+
+        popdata->trait_values->clear();
 
         for (QuantitativeTraitPtrs::const_iterator qt=config_.quantitative_traits.begin();
              qt!=config_.quantitative_traits.end(); ++qt)
@@ -128,6 +169,8 @@ void Simulator::simulate_single_generation()
 
     // update
 
+    spare_populations_ = current_populations_;
+    spare_population_datas_ = current_population_datas_;
     current_populations_ = next_populations;
     current_population_datas_ = next_population_datas;
 
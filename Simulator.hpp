@@ -38,6 +38,9 @@ class Simulator
         unsigned int seed;                                      // for Random
         std::string output_directory;                           // all output files placed here
         std::ostream* os_progress;                              // progress update stream (default: stdout)
+        size_t thread_count;                                    // threads for creating offspring and genotyping (default: 1)
+        Sampler sampler;                                        // parent sampling backend (default: binary search)
+        bool cache_snp_indicator;                               // evaluate snp_indicator once per founder and locus (default: false)
 
         std::vector<std::string> genetic_map_filenames;         // one filename for each chromosome pair
         std::vector<Population::Configs> population_configs;    // Population::Configs for each generation
@@ -47,7 +50,7 @@ class Simulator
         FitnessFunctionPtr fitness_function;
         ReporterPtrs reporters;
 
-        Config() : seed(0), os_progress(&std::cout) {}
+        Config() : seed(0), os_progress(&std::cout), thread_count(1), sampler(Sampler_BinarySearch), cache_snp_indicator(false) {}
     };
 
     Simulator(const Config& config);  
@@ -65,6 +68,10 @@ class Simulator
     size_t current_generation_;
     PopulationPtrsPtr current_populations_;
     PopulationDatasPtr current_population_datas_;
+
+    // generation g-2, whose storage is reused for the next generation
+    PopulationPtrsPtr spare_populations_;
+    PopulationDatasPtr spare_population_datas_;
 };
 
 
@@ -0,0 +1,62 @@
+//
+// Span.hpp
+//
+// Copyright 2013 Darren Kessner
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+
+
+#ifndef _SPAN_HPP_
+#define _SPAN_HPP_
+
+
+#include <cstddef>
+
+
+//
+// Span: read-only view of a contiguous array owned elsewhere (e.g. a vector,
+// or a memory-mapped file), with the const part of the std::vector interface
+//
+template <typename T>
+class Span
+{
+    public:
+
+    typedef T value_type;
+    typedef const T* const_iterator;
+    typedef const T* iterator;
+    typedef const T& const_reference;
+
+    Span() : begin_(0), end_(0) {}
+    Span(const T* begin, const T* end) : begin_(begin), end_(end) {}
+    Span(const T* begin, size_t size) : begin_(begin), end_(begin+size) {}
+
+    const_iterator begin() const {return begin_;}
+    const_iterator end() const {return end_;}
+    size_t size() const {return end_ - begin_;}
+    bool empty() const {return begin_ == end_;}
+
+    const T& operator[](size_t index) const {return begin_[index];}
+    const T& front() const {return *begin_;}
+    const T& back() const {return *(end_-1);}
+    const T* data() const {return begin_;}
+
+    private:
+    const T* begin_;
+    const T* end_;
+};
+
+
+#endif // _SPAN_HPP_
+
@@ -76,7 +76,7 @@ string getSequence(const Chromosome& chromosome, const MSFormat& ms1,
 {
     string sequence;
 
-    for (vector<DNABlock>::const_iterator it=chromosome.blocks().begin(); 
+    for (DNABlockSpan::const_iterator it=chromosome.blocks().begin(); 
          it!=chromosome.blocks().end(); ++it)
     {
         double begin = relativePosition(it->position);
@@ -25,9 +25,9 @@
 // and facilitate switching implementations
 
 
-#include "boost/shared_ptr.hpp"
+#include <memory>
 
-using boost::shared_ptr;
+using std::shared_ptr;
 
 
 #endif // _SHARED_PTR_HPP_
@@ -18,6 +18,7 @@
 
 
 #include "Population.hpp"
+#include "RecombinationMap.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -37,6 +38,7 @@ int main(int argc, char* argv[])
         usage << "Functions:\n";
         usage << "    simrecomb_aux txt2pop filename_in filename_out\n";
         usage << "    simrecomb_aux pop2txt filename_in filename_out\n";
+        usage << "    simrecomb_aux txt2map genetic_map_filename_in filename_out\n";
         usage << endl;
         usage << "Darren Kessner\n";
         usage << "John Novembre Lab, UCLA\n";
@@ -77,6 +79,19 @@ int main(int argc, char* argv[])
             os << p;
             os.close();
         }
+        else if (function == "txt2map")
+        {
+            if (argc < 4) throw runtime_error(usage.str().c_str());
+            string filename_in = argv[2];
+            string filename_out = argv[3];
+
+            cout << "reading " << filename_in << endl << flush;
+            Random random;
+            RecombinationMap map(filename_in, random);
+
+            cout << "writing " << filename_out << endl << flush;
+            map.write_binary(filename_out);
+        }
         else
         {
             throw runtime_error(usage.str().c_str());